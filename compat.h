@@ -4,6 +4,15 @@
 #ifndef __COMPAT_H
 #define __COMPAT_H
 
+#include <linux/version.h>
+#include <linux/hid.h>
+#include <linux/eventfd.h>
+#include <linux/hrtimer.h>
+#include <linux/input.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/usb.h>
+
 #ifndef HID_CP_CONSUMER_CONTROL
 #define HID_CP_CONSUMER_CONTROL 0x000c0001
 #endif
@@ -12,18 +21,38 @@
 #define HID_GD_SYSTEM_CONTROL   0x00010080
 #endif
 
-#ifndef module_hid_driver
-/**
- * module_hid_driver() - Helper macro for registering a HID driver
- * @__hid_driver: hid_driver struct
- *
- * Helper macro for HID drivers which do not do anything special in module
- * init/exit. This eliminates a lot of boilerplate. Each module may only
- * use this macro once, and calling it replaces module_init() and module_exit()
- */
-#define module_hid_driver(__hid_driver) \
-	module_driver(__hid_driver, hid_register_driver, \
-		      hid_unregister_driver)
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
+static inline bool hid_is_usb(struct hid_device *hdev)
+{
+	return hid_is_using_ll_driver(hdev, &usb_hid_driver);
+}
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 4, 0)
+/* Events are stamped at input_sync() time instead */
+static inline void input_set_timestamp(struct input_dev *dev, ktime_t timestamp)
+{
+}
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 8, 0)
+#define eventfd_signal(ctx) eventfd_signal((ctx), 1)
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 3, 0)
+static inline void vm_flags_clear(struct vm_area_struct *vma, unsigned long flags)
+{
+	vma->vm_flags &= ~flags;
+}
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 13, 0)
+static inline void hrtimer_setup(struct hrtimer *timer, enum hrtimer_restart (*function)(struct hrtimer *),
+				 clockid_t clock_id, enum hrtimer_mode mode)
+{
+	hrtimer_init(timer, clock_id, mode);
+	timer->function = function;
+}
 #endif
 
 #endif
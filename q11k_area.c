@@ -0,0 +1,110 @@
+#include "q11k_core.h"
+
+/*
+ * With u, v the position inside the area (w x h) and the tablet turned
+ * clockwise on the desk, the desk-aligned output is
+ *
+ *     0:   ( u,     v     )    range w x h
+ *     90:  ( h - v, u     )    range h x w
+ *     180: ( w - u, h - v )    range w x h
+ *     270: ( v,     w - u )    range h x w
+ */
+
+#define Q11K_AREA_ONE       ((s64)1 << Q11K_AREA_SHIFT)
+
+static int q11k_area_clamp(s64 v, int max)
+{
+    if (v < 0)
+    {
+        return 0;
+    }
+    return (v > max) ? max : (int)v;
+}
+
+void q11k_area_defaults(q11k_area_params_t* p)
+{
+    p->x = 0;
+    p->y = 0;
+    p->width = 0;
+    p->height = 0;
+    p->rotation = 0;
+    p->left_handed = 0;
+}
+
+int q11k_area_compile(const q11k_area_params_t* p, q11k_area_matrix_t* m)
+{
+    u32 x = p->x;
+    u32 y = p->y;
+    u32 w = p->width;
+    u32 h = p->height;
+    u32 rotation = p->rotation;
+
+    if (rotation % 90 != 0 || rotation >= 360)
+    {
+        return -EINVAL;
+    }
+    if (x >= MAX_ABS_X || y >= MAX_ABS_Y)
+    {
+        return -ERANGE;
+    }
+
+    w = (w != 0) ? w : MAX_ABS_X - x;
+    h = (h != 0) ? h : MAX_ABS_Y - y;
+    if (x + w > MAX_ABS_X || y + h > MAX_ABS_Y)
+    {
+        return -ERANGE;
+    }
+
+    if (p->left_handed)
+    {
+        rotation = (rotation + 180) % 360;
+    }
+
+    m->xx = 0;
+    m->xy = 0;
+    m->yx = 0;
+    m->yy = 0;
+
+    switch (rotation)
+    {
+        case 0:
+            m->xx = Q11K_AREA_ONE;
+            m->tx = -(s64)x;
+            m->yy = Q11K_AREA_ONE;
+            m->ty = -(s64)y;
+            break;
+        case 90:
+            m->xy = -Q11K_AREA_ONE;
+            m->tx = (s64)h + y;
+            m->yx = Q11K_AREA_ONE;
+            m->ty = -(s64)x;
+            break;
+        case 180:
+            m->xx = -Q11K_AREA_ONE;
+            m->tx = (s64)w + x;
+            m->yy = -Q11K_AREA_ONE;
+            m->ty = (s64)h + y;
+            break;
+        case 270:
+            m->xy = Q11K_AREA_ONE;
+            m->tx = -(s64)y;
+            m->yx = -Q11K_AREA_ONE;
+            m->ty = (s64)w + x;
+            break;
+    }
+
+    m->tx *= Q11K_AREA_ONE;
+    m->ty *= Q11K_AREA_ONE;
+    m->max_x = (rotation % 180 == 0) ? w : h;
+    m->max_y = (rotation % 180 == 0) ? h : w;
+    return 0;
+}
+
+void q11k_area_apply(const q11k_area_matrix_t* m, int* x, int* y)
+{
+    s64 out_x = m->xx * *x + m->xy * *y + m->tx;
+    s64 out_y = m->yx * *x + m->yy * *y + m->ty;
+
+    *x = q11k_area_clamp(out_x >> Q11K_AREA_SHIFT, m->max_x);
+    *y = q11k_area_clamp(out_y >> Q11K_AREA_SHIFT, m->max_y);
+}
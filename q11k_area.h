@@ -0,0 +1,51 @@
+/*
+ * Active area and orientation of the pen surface: crops the surface to a
+ * rectangle (e.g. one matching the monitor's aspect ratio) and rotates
+ * it, compiled into one fixed-point affine transform so the report path
+ * does two multiply-adds per axis. Included by q11k_core.h.
+ */
+#ifndef __Q11K_AREA_H
+#define __Q11K_AREA_H
+
+#define Q11K_AREA_SHIFT             16
+
+/*
+ * Tunables, part of q11k_config_t; u32 for the sysfs accessor. They only
+ * take effect through q11k_area_compile().
+ */
+typedef struct __tag_q11k_area_params_t
+{
+    u32 x;                  /* top left corner of the active area, counts */
+    u32 y;
+    u32 width;              /* 0 = up to the edge of the surface */
+    u32 height;
+    u32 rotation;           /* degrees clockwise the tablet is turned, 0/90/180/270 */
+    u32 left_handed;        /* tablet turned around, another 180 degrees */
+} q11k_area_params_t;
+
+/* out = (m * (x, y, 1)) >> Q11K_AREA_SHIFT, clamped to [0, max] */
+typedef struct __tag_q11k_area_matrix_t
+{
+    s64 xx;
+    s64 xy;
+    s64 tx;
+    s64 yx;
+    s64 yy;
+    s64 ty;
+    int max_x;
+    int max_y;
+} q11k_area_matrix_t;
+
+void q11k_area_defaults(q11k_area_params_t* p);
+
+/*
+ * Build the matrix for @p. Returns -EINVAL for a rotation that is not a
+ * multiple of 90 and -ERANGE for an area that does not fit the surface,
+ * leaving @m untouched.
+ */
+int q11k_area_compile(const q11k_area_params_t* p, q11k_area_matrix_t* m);
+
+/* Map one surface position to the output range in place */
+void q11k_area_apply(const q11k_area_matrix_t* m, int* x, int* y);
+
+#endif
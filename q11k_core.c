@@ -0,0 +1,924 @@
+#include "q11k_core.h"
+#include "q11k_trace.h"
+
+#ifdef __KERNEL__
+#include <linux/string.h>
+#else
+#include <string.h>
+#endif
+
+const unsigned short q11k_pad_modifiers[Q11K_PAD_MODIFIER_COUNT] = {
+    KEY_RIGHTCTRL,
+    KEY_RIGHTALT
+};
+
+const unsigned short q11k_default_keymap[Q11K_KEYMAP_SIZE] = {
+    [Q11K_SCAN_KEY(0x01)]     = Q11K_KEY_TOP_LEFT,
+    [Q11K_SCAN_KEY(0x02)]     = Q11K_KEY_TOP_MIDDLE,
+    [Q11K_SCAN_KEY(0x04)]     = Q11K_KEY_TOP_RIGHT,
+    [Q11K_SCAN_KEY(0x08)]     = Q11K_KEY_BOTTOM_LEFT,
+    [Q11K_SCAN_KEY(0x10)]     = Q11K_KEY_BOTTOM_MIDDLE,
+    [Q11K_SCAN_KEY(0x20)]     = Q11K_KEY_BOTTOM_RIGHT,
+    [Q11K_SCAN_KEY(0x40)]     = Q11K_KEY_6,
+    [Q11K_SCAN_KEY(0x80)]     = Q11K_KEY_7,
+
+    [Q11K_SCAN_GESTURE(0x01)] = Q11K_VKEY_1_CLICK,
+    [Q11K_SCAN_GESTURE(0x11)] = Q11K_VKEY_2_CLICK,
+    [Q11K_SCAN_GESTURE(0x12)] = Q11K_VKEY_2_LEFT,
+    [Q11K_SCAN_GESTURE(0x13)] = Q11K_VKEY_2_RIGHT,
+    [Q11K_SCAN_GESTURE(0x14)] = Q11K_VKEY_2_UP,
+    [Q11K_SCAN_GESTURE(0x15)] = Q11K_VKEY_2_DOWN,
+    [Q11K_SCAN_GESTURE(0x22)] = Q11K_VKEY_3_UP,
+    [Q11K_SCAN_GESTURE(0x23)] = Q11K_VKEY_3_DOWN,
+    [Q11K_SCAN_GESTURE(0x24)] = Q11K_VKEY_3_LEFT,
+    [Q11K_SCAN_GESTURE(0x25)] = Q11K_VKEY_3_RIGHT,
+    [Q11K_SCAN_GESTURE(0x31)] = Q11K_VKEY_4_CLICK,
+};
+
+const q11k_stylus_route_t q11k_stylus_routes[Q11K_STYLUS_MODES] = {
+    [Q11K_STYLUS_PEN]   = { Q11K_INPUT_PEN,      { BTN_STYLUS, BTN_STYLUS2 } },
+    [Q11K_STYLUS_MOUSE] = { Q11K_INPUT_KEYBOARD, { BTN_MIDDLE, BTN_RIGHT } },
+};
+
+/*
+ * Report handlers, indexed by the report type byte (data[1]). Each entry
+ * carries the shortest report it can decode; longer reports from other
+ * models are passed through whole.
+ */
+typedef void (*q11k_report_func_t)(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now);
+
+typedef struct __tag_q11k_report_handler_t
+{
+    q11k_report_func_t handle;
+    int min_size;
+    enum q11k_iface iface;
+} q11k_report_handler_t;
+
+static void q11k_on_key_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now);
+static void q11k_on_gesture_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now);
+static void q11k_on_mouse_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now);
+static void q11k_on_pen_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now);
+static void q11k_on_pen_leave_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now);
+
+static const q11k_report_handler_t q11k_report_handlers[Q11K_REPORT_TYPES] = {
+    [0xe0] = { q11k_on_key_report,       5, Q11K_IFACE_PAD },
+    [0xe1] = { q11k_on_gesture_report,   5, Q11K_IFACE_PAD },
+    [0x90] = { q11k_on_mouse_report,     6, Q11K_IFACE_PEN },
+    [0x80] = { q11k_on_pen_report,       8, Q11K_IFACE_PEN },
+    [0x81] = { q11k_on_pen_report,       8, Q11K_IFACE_PEN },
+    [0x82] = { q11k_on_pen_report,       8, Q11K_IFACE_PEN },
+    [0x84] = { q11k_on_pen_report,       8, Q11K_IFACE_PEN },
+    [0xc0] = { q11k_on_pen_leave_report, 2, Q11K_IFACE_PEN },
+};
+
+/*
+ * Strip gestures the scroll mode takes over, two finger (0x1x) and, with
+ * scroll.three_finger, three finger (0x2x) swipes alike: wheel (0) or
+ * hwheel (1), and direction.
+ */
+typedef struct __tag_q11k_scroll_action_t
+{
+    u8 axis;
+    s8 dir;
+} q11k_scroll_action_t;
+
+static const q11k_scroll_action_t q11k_scroll_actions[0x40] = {
+    [0x12] = { 1, -1 },
+    [0x13] = { 1,  1 },
+    [0x14] = { 0,  1 },
+    [0x15] = { 0, -1 },
+    [0x22] = { 0,  1 },
+    [0x23] = { 0, -1 },
+    [0x24] = { 1, -1 },
+    [0x25] = { 1,  1 },
+};
+
+static const unsigned int q11k_scroll_hires_codes[2] = { REL_WHEEL_HI_RES, REL_HWHEEL_HI_RES };
+static const unsigned int q11k_scroll_detent_codes[2] = { REL_WHEEL, REL_HWHEEL };
+
+static void q11k_handle_key_event(q11k_state_t* st, u8 b_key_raw, u64 now);
+static void q11k_handle_gesture_event(q11k_state_t* st, const q11k_config_t* cfg, u8 b_key_raw, u64 now);
+static void q11k_handle_mouse_event(q11k_state_t* st, const q11k_config_t* cfg, int x_pos, int y_pos, u64 now);
+static void q11k_handle_pen_event(q11k_state_t* st, const q11k_config_t* cfg, u8 b_key_raw, int x_pos, int y_pos, int pressure, u64 now);
+
+static void q11k_handle_key_mapping_event(
+    q11k_state_t* st,
+    const unsigned short mods[],
+    int modc,
+    unsigned short new_key,
+    unsigned short* last_key_p,
+    unsigned int scancode,
+    u64 now);
+static unsigned short q11k_mapping_lookup(q11k_state_t* st, unsigned int scancode);
+
+static bool q11k_scroll_gesture(q11k_state_t* st, const q11k_config_t* cfg, u8 b_key_raw, u64 now);
+static int q11k_scroll_step(q11k_scroll_state_t* sc, const q11k_scroll_params_t* p, u8 b_key_raw, u64 now);
+
+static bool q11k_report_pad_key(q11k_state_t* st, unsigned short key, int value);
+static bool q11k_report_keys(q11k_state_t* st, const unsigned short* mods, int modc, unsigned short key, int value, bool keep_mods);
+static void q11k_report_pen_frame(q11k_state_t* st, const q11k_config_t* cfg, const q11k_pen_frame_t* frame, u64 now);
+static unsigned int q11k_report_stylus(q11k_state_t* st, const q11k_config_t* cfg, int button, bool value);
+
+static void q11k_relative_pen_toggle(q11k_state_t* st);
+static void q11k_relative_pen_sync(q11k_state_t* st);
+static bool q11k_relative_pen_is_enabled(q11k_state_t* st);
+static void q11k_relative_pen_enable(q11k_state_t* st);
+static void q11k_relative_pen_disable(q11k_state_t* st);
+static void q11k_relative_pen_reset_origin(q11k_state_t* st);
+static void q11k_relative_pen_update_origin(q11k_state_t* st, s64 x, s64 y);
+static void q11k_relative_pen_check_and_try_reset_last_abs_pos(q11k_state_t* st, const q11k_relative_params_t* p, u64 now);
+static void q11k_relative_pen_reset_last_abs_pos(q11k_state_t* st);
+static void q11k_relative_pen_limit_xy(const q11k_config_t* cfg, s64* xp, s64* yp);
+static void q11k_relative_pen_update_last_abs_pos(q11k_state_t* st, int x, int y, u64 now);
+static u32 q11k_relative_pen_gain(q11k_state_t* st, const q11k_relative_params_t* p, int dx, int dy, u64 now);
+static void q11k_relative_pen_get_rel_pos(q11k_state_t* st, const q11k_relative_params_t* p, int abs_x, int abs_y, u64 now, s64* rel_x, s64* rel_y);
+
+void q11k_config_init(q11k_config_t* cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+
+    q11k_filter_defaults(&cfg->filter);
+    q11k_deadband_defaults(&cfg->deadband);
+    q11k_area_defaults(&cfg->area);
+    q11k_area_compile(&cfg->area, &cfg->area_matrix);
+
+    cfg->relative.gain = REL_PEN_DEF_GAIN;
+    cfg->relative.accel = REL_PEN_DEF_ACCEL;
+    cfg->relative.max_gain = REL_PEN_DEF_MAX_GAIN;
+    cfg->relative.gap_ms = REL_PEN_DEF_GAP_MS;
+
+    cfg->scroll.enabled = 0;
+    cfg->scroll.three_finger = 1;
+    cfg->scroll.step = Q11K_SCROLL_DEF_STEP;
+    cfg->scroll.accel = Q11K_SCROLL_DEF_ACCEL;
+    cfg->scroll.max_step = Q11K_SCROLL_DEF_MAX_STEP;
+
+    cfg->prox_timeout_ms = Q11K_PROX_DEF_TIMEOUT_MS;
+    cfg->stylus_mode = Q11K_STYLUS_PEN;
+    cfg->pressure = NULL;
+}
+
+void q11k_core_init(q11k_state_t* st, const struct q11k_sink_ops* ops, void* ctx)
+{
+    st->ops = ops;
+    st->ctx = ctx;
+
+    q11k_config_init(&st->default_config);
+    RCU_INIT_POINTER(st->config, &st->default_config);
+    atomic_set(&st->modes, 0);
+
+    memset(&st->pen.reported, 0, sizeof(st->pen.reported));
+    st->pen.last_ns = 0;
+    st->pen.stylus_held[0] = &q11k_stylus_routes[Q11K_STYLUS_PEN];
+    st->pen.stylus_held[1] = &q11k_stylus_routes[Q11K_STYLUS_PEN];
+    q11k_filter_init(&st->pen.filter);
+    q11k_deadband_reset(&st->pen.deadband);
+
+    st->pad.last_key = 0;
+    st->pad.last_vkey = 0;
+    st->pad.strip_held = false;
+    memset(st->pad.keys_down, 0, sizeof(st->pad.keys_down));
+    memcpy(st->pad.keymap, q11k_default_keymap, sizeof(st->pad.keymap));
+
+    st->pad.scroll.last_raw = 0;
+    st->pad.scroll.last_ns = 0;
+    st->pad.scroll.remainder[0] = 0;
+    st->pad.scroll.remainder[1] = 0;
+
+    st->pen.rel_pen_data.enabled = false;
+    st->pen.rel_pen_data.last_x = -1;
+    st->pen.rel_pen_data.last_y = -1;
+    st->pen.rel_pen_data.origin_x = 0;
+    st->pen.rel_pen_data.origin_y = 0;
+    st->pen.rel_pen_data.reseting_count = 0;
+    st->pen.rel_pen_data.last_ns = 0;
+
+    memset(&st->stats, 0, sizeof(st->stats));
+}
+
+u64 q11k_core_pen_deadline(q11k_state_t* st)
+{
+    u32 timeout_ms = q11k_core_config(st)->prox_timeout_ms;
+
+    if (st->pen.reported.prox == Q11K_PROX_OUT || timeout_ms == 0)
+    {
+        return 0;
+    }
+
+    return st->pen.last_ns + (u64)timeout_ms * 1000000;
+}
+
+void q11k_core_pen_release(q11k_state_t* st, u64 now)
+{
+    q11k_pen_frame_t frame = st->pen.reported;
+
+    if (frame.prox == Q11K_PROX_OUT)
+    {
+        return;
+    }
+
+    frame.prox = Q11K_PROX_OUT;
+    frame.stylus = false;
+    frame.stylus2 = false;
+    frame.pressure = 0;
+    q11k_report_pen_frame(st, q11k_core_config(st), &frame, now);
+    q11k_deadband_reset(&st->pen.deadband);
+}
+
+bool q11k_core_raw_event(q11k_state_t* st, const u8* data, int size, u64 now)
+{
+    const q11k_report_handler_t* h;
+    const q11k_config_t* cfg;
+
+    trace_q11k_raw_report(st, data, size);
+
+    /* everything the tablet sends is vendor report 8 */
+    if (size > 0 && data[0] != Q11K_REPORT_ID)
+    {
+        atomic_inc(&st->stats.foreign[data[0]]);
+        return false;
+    }
+    if (size < Q11K_REPORT_HEADER_SIZE)
+    {
+        atomic_inc(&st->stats.truncated);
+        return false;
+    }
+
+    h = &q11k_report_handlers[data[1]];
+    if (h->handle == NULL)
+    {
+        atomic_inc(&st->stats.unhandled[data[1]]);
+        return false;
+    }
+    if (size < h->min_size)
+    {
+        atomic_inc(&st->stats.truncated);
+        return false;
+    }
+
+    /* one config for the whole report, however it is retuned meanwhile */
+    cfg = q11k_core_config(st);
+    h->handle(st, cfg, data, size, now);
+    return true;
+}
+
+bool q11k_core_iface_event(q11k_state_t* st, enum q11k_iface iface, const u8* data, int size, u64 now)
+{
+    if (size >= Q11K_REPORT_HEADER_SIZE && data[0] == Q11K_REPORT_ID)
+    {
+        const q11k_report_handler_t* h = &q11k_report_handlers[data[1]];
+
+        if (h->handle != NULL && h->iface != iface)
+        {
+            trace_q11k_raw_report(st, data, size);
+            atomic_inc(&st->stats.misrouted);
+            return false;
+        }
+    }
+
+    return q11k_core_raw_event(st, data, size, now);
+}
+
+static void q11k_on_key_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now)
+{
+    q11k_handle_key_event(st, data[4], now);
+}
+
+static void q11k_on_gesture_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now)
+{
+    q11k_handle_gesture_event(st, cfg, data[4], now);
+}
+
+static void q11k_on_mouse_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now)
+{
+    int x_pos, y_pos;
+
+    q11k_calculate_mouse_data(data, &x_pos, &y_pos);
+    trace_q11k_pen_sample(st, data[1], x_pos, y_pos, 0);
+    q11k_handle_mouse_event(st, cfg, x_pos, y_pos, now);
+}
+
+static void q11k_on_pen_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now)
+{
+    int pressure, x_pos, y_pos;
+
+    q11k_calculate_pen_data(data, &x_pos, &y_pos, &pressure);
+    trace_q11k_pen_sample(st, data[1], x_pos, y_pos, pressure);
+    st->pen.last_ns = now;
+    q11k_handle_pen_event(st, cfg, data[1], x_pos, y_pos, pressure, now);
+}
+
+/*
+ * Sent once as the pen leaves range: the pen report type with the
+ * out-of-range bit (0x40) added. Releases the pen and its buttons.
+ */
+static void q11k_on_pen_leave_report(q11k_state_t* st, const q11k_config_t* cfg, const u8* data, int size, u64 now)
+{
+    st->pen.last_ns = now;
+    q11k_core_pen_release(st, now);
+}
+
+static void q11k_handle_key_event(q11k_state_t* st, u8 b_key_raw, u64 now)
+{
+    unsigned int scancode = Q11K_SCAN_KEY(b_key_raw);
+    unsigned short key = (b_key_raw == 0x00) ? 0 : q11k_mapping_lookup(st, scancode);
+
+    trace_q11k_key_map(st, scancode, key);
+    q11k_handle_key_mapping_event(st, q11k_pad_modifiers, Q11K_PAD_MODIFIER_COUNT,
+                                  key, &st->pad.last_key, scancode, now);
+}
+
+static void q11k_handle_gesture_event(q11k_state_t* st, const q11k_config_t* cfg, u8 b_key_raw, u64 now)
+{
+    unsigned int scancode = Q11K_SCAN_GESTURE(b_key_raw);
+    unsigned short key;
+
+    if (b_key_raw == 0x00 && st->pad.last_vkey == 0)
+    {
+        /* a strip tap with no gesture held toggles the relative mode on
+           its press; the following 0x00 is its release */
+        if (!st->pad.strip_held)
+        {
+            q11k_relative_pen_toggle(st);
+        }
+        st->pad.strip_held = !st->pad.strip_held;
+        return;
+    }
+
+    if (b_key_raw != 0x00 && q11k_scroll_gesture(st, cfg, b_key_raw, now))
+    {
+        /* the strip is held until the 0x00 like for an unmapped gesture */
+        st->pad.strip_held = true;
+        return;
+    }
+
+    key = (b_key_raw == 0x00) ? 0 : q11k_mapping_lookup(st, scancode);
+    trace_q11k_key_map(st, scancode, key);
+
+    /* an unmapped gesture still holds the strip until its 0x00 */
+    st->pad.strip_held = (key == KEY_UNKNOWN);
+    q11k_handle_key_mapping_event(st, NULL, 0, key, &st->pad.last_vkey, scancode, now);
+}
+
+static void q11k_handle_mouse_event(q11k_state_t* st, const q11k_config_t* cfg, int x_pos, int y_pos, u64 now)
+{
+    q11k_pen_frame_t frame = st->pen.reported;
+
+    q11k_area_apply(&cfg->area_matrix, &x_pos, &y_pos);
+    frame.x = x_pos;
+    frame.y = y_pos;
+    q11k_report_pen_frame(st, cfg, &frame, now);
+}
+
+static void q11k_handle_pen_event(q11k_state_t* st, const q11k_config_t* cfg, u8 b_key_raw, int x_pos, int y_pos, int pressure, u64 now)
+{
+    q11k_pen_frame_t frame = st->pen.reported;
+    const q11k_pressure_lut_t* lut = cfg->pressure;
+    int rpt_x;
+    int rpt_y;
+
+    q11k_relative_pen_sync(st);
+
+    /* the deadband works in surface counts; relative mode works on the
+       mapped position, so it follows rotation */
+    q11k_filter_apply(&st->pen.filter, &cfg->filter, &x_pos, &y_pos, now);
+    if (b_key_raw == 0x81)
+    {
+        q11k_deadband_apply(&st->pen.deadband, &cfg->deadband, &x_pos, &y_pos, &pressure, pressure > 0, now);
+    }
+    else
+    {
+        q11k_deadband_apply(&st->pen.deadband, &cfg->deadband, &x_pos, &y_pos, NULL,
+                            b_key_raw != 0x80 && frame.prox == Q11K_PROX_CONTACT, now);
+    }
+    q11k_area_apply(&cfg->area_matrix, &x_pos, &y_pos);
+    rpt_x = x_pos;
+    rpt_y = y_pos;
+
+    /* every pen report means in range; contact is a 0x81 with pressure */
+    switch (b_key_raw)
+    {
+        case 0x80:
+            frame.stylus = false;
+            frame.stylus2 = false;
+            frame.prox = Q11K_PROX_IN;
+            frame.pressure = 0;
+            break;
+        case 0x81:
+        {
+            frame.prox = (pressure > 0) ? Q11K_PROX_CONTACT : Q11K_PROX_IN;
+            frame.pressure = (lut != NULL) ? q11k_pressure_map(lut, pressure) : pressure;
+            break;
+        }
+        case 0x82:
+        {
+            frame.stylus = true;
+            break;
+        }
+        case 0x84:
+        {
+            frame.stylus2 = true;
+            break;
+        }
+    }
+
+    if (frame.prox == Q11K_PROX_OUT)
+    {
+        frame.prox = Q11K_PROX_IN;
+    }
+
+    if(q11k_relative_pen_is_enabled(st))
+    {
+        s64 rel_x = 0;
+        s64 rel_y = 0;
+        s64 org_x, org_y;
+
+        q11k_relative_pen_check_and_try_reset_last_abs_pos(st, &cfg->relative, now);
+        q11k_relative_pen_get_rel_pos(st, &cfg->relative, x_pos, y_pos, now, &rel_x, &rel_y);
+
+        org_x = st->pen.rel_pen_data.origin_x + rel_x;
+        org_y = st->pen.rel_pen_data.origin_y + rel_y;
+
+        q11k_relative_pen_limit_xy(cfg, &org_x, &org_y);
+        q11k_relative_pen_update_origin(st, org_x, org_y);
+
+        rpt_x = (int)(org_x >> REL_PEN_SHIFT);
+        rpt_y = (int)(org_y >> REL_PEN_SHIFT);
+
+        q11k_relative_pen_update_last_abs_pos(st, x_pos, y_pos, now);
+    }
+
+    frame.x = rpt_x;
+    frame.y = rpt_y;
+    q11k_report_pen_frame(st, cfg, &frame, now);
+}
+
+/*
+ * @new_key is the mapped key of a press, 0 for a release (raw 0x00) or
+ * KEY_UNKNOWN for an unmapped code; @last_key_p tracks the held key of
+ * the key or gesture table.
+ */
+static void q11k_handle_key_mapping_event(
+    q11k_state_t* st,
+    const unsigned short mods[],
+    int modc,
+    unsigned short new_key,
+    unsigned short* last_key_p,
+    unsigned int scancode,
+    u64 now)
+{
+    int value = 1;
+    bool changed = false;
+    bool pressing;
+    int t_last_key;
+
+    if (new_key == 0)
+    {
+        value = 0;
+        new_key = *last_key_p;
+    }
+
+    pressing = (new_key != KEY_UNKNOWN && new_key != 0);
+    t_last_key = *last_key_p;
+
+    /* switching keys: release the old one in the same frame as the new
+       press, leaving the modifiers held */
+    if (t_last_key != 0 && t_last_key != new_key && value != 0)
+    {
+        changed |= q11k_report_keys(st, mods, modc, t_last_key, 0, pressing);
+    }
+
+    if (pressing)
+    {
+        if (value != 0 && new_key != t_last_key)
+        {
+            q11k_sink_msc(st, Q11K_INPUT_KEYBOARD, MSC_SCAN, scancode);
+        }
+        changed |= q11k_report_keys(st, mods, modc, new_key, value, false);
+    }
+
+    *last_key_p = (pressing && value != 0) ? new_key : 0;
+
+    if (changed)
+    {
+        q11k_sink_sync(st, Q11K_INPUT_KEYBOARD, now);
+    }
+}
+
+/*
+ * Scroll mode: one notch of a strip swipe becomes a hi-res wheel event
+ * on the scroll device, plus a classic wheel event for every full
+ * detent accumulated. Returns false if the gesture is left to the keymap.
+ */
+static bool q11k_scroll_gesture(q11k_state_t* st, const q11k_config_t* cfg, u8 b_key_raw, u64 now)
+{
+    q11k_scroll_state_t* sc = &st->pad.scroll;
+    const q11k_scroll_action_t* a;
+    int value, detents;
+
+    if (!cfg->scroll.enabled || b_key_raw >= ARRAY_SIZE(q11k_scroll_actions))
+    {
+        return false;
+    }
+    a = &q11k_scroll_actions[b_key_raw];
+    if (a->dir == 0 || ((b_key_raw & 0xf0) == 0x20 && !cfg->scroll.three_finger))
+    {
+        return false;
+    }
+
+    /* a mapped gesture still held from before the swipe */
+    if (st->pad.last_vkey != 0)
+    {
+        q11k_handle_key_mapping_event(st, NULL, 0, 0, &st->pad.last_vkey, Q11K_SCAN_GESTURE(b_key_raw), now);
+    }
+
+    value = a->dir * q11k_scroll_step(sc, &cfg->scroll, b_key_raw, now);
+    q11k_sink_rel(st, Q11K_INPUT_SCROLL, q11k_scroll_hires_codes[a->axis], value);
+    trace_q11k_scroll(st, q11k_scroll_hires_codes[a->axis], value);
+
+    sc->remainder[a->axis] += value;
+    detents = sc->remainder[a->axis] / Q11K_SCROLL_DETENT;
+    if (detents != 0)
+    {
+        q11k_sink_rel(st, Q11K_INPUT_SCROLL, q11k_scroll_detent_codes[a->axis], detents);
+        sc->remainder[a->axis] -= detents * Q11K_SCROLL_DETENT;
+    }
+
+    q11k_sink_sync(st, Q11K_INPUT_SCROLL, now);
+    return true;
+}
+
+/*
+ * Hi-res units for this notch: step + step * accel * speed, speed in
+ * notches/s of the current swipe, capped at max_step. A new direction
+ * or a pause starts over at rest and forgets partial detents.
+ */
+static int q11k_scroll_step(q11k_scroll_state_t* sc, const q11k_scroll_params_t* p, u8 b_key_raw, u64 now)
+{
+    u32 step = p->step;
+    u32 accel = p->accel;
+    u32 max_step = p->max_step;
+    u64 dt = now - sc->last_ns;
+    u64 result = step;
+
+    if (b_key_raw != sc->last_raw || dt >= Q11K_SCROLL_GAP_NS)
+    {
+        sc->remainder[0] = 0;
+        sc->remainder[1] = 0;
+    }
+    else if (accel != 0 && dt != 0)
+    {
+        u64 speed = div_u64(1000000000ull, (u32)dt);
+
+        result += div_u64((u64)step * accel * speed, 1000);
+        if (result > max_step)
+        {
+            result = (max_step > step) ? max_step : step;
+        }
+    }
+
+    sc->last_raw = b_key_raw;
+    sc->last_ns = now;
+    return (int)result;
+}
+
+/* Unmapped (KEY_RESERVED) entries read as KEY_UNKNOWN */
+static unsigned short q11k_mapping_lookup(q11k_state_t* st, unsigned int scancode)
+{
+    unsigned short key = st->pad.keymap[scancode];
+
+    return (key != KEY_RESERVED) ? key : KEY_UNKNOWN;
+}
+
+static bool q11k_report_pad_key(q11k_state_t* st, unsigned short key, int value)
+{
+    atomic_t* word = &st->pad.keys_down[key / 32];
+    int bit = 1u << (key % 32);
+    int old;
+
+    old = value ? atomic_fetch_or(bit, word) : atomic_fetch_andnot(bit, word);
+    if (((old & bit) != 0) == (value != 0))
+    {
+        return false;
+    }
+
+    q11k_sink_key(st, Q11K_INPUT_KEYBOARD, key, value);
+    return true;
+}
+
+/* Press @key with its modifiers, or release it and (unless @keep_mods) them */
+static bool q11k_report_keys(q11k_state_t* st, const unsigned short* mods, int modc, unsigned short key, int value, bool keep_mods)
+{
+    bool changed = false;
+    int i = 0;
+
+    if (value != 0)
+    {
+        for (i = 0; i < modc; ++i)
+        {
+            changed |= q11k_report_pad_key(st, mods[i], 1);
+        }
+        changed |= q11k_report_pad_key(st, key, 1);
+    }
+    else
+    {
+        changed |= q11k_report_pad_key(st, key, 0);
+        for (i = 0; i < modc && !keep_mods; ++i)
+        {
+            changed |= q11k_report_pad_key(st, mods[i], 0);
+        }
+    }
+
+    return changed;
+}
+
+/*
+ * Emit the difference between @frame and the last reported pen frame and
+ * close it with a single sync per touched device. The stylus buttons go
+ * wherever their route points (see q11k_report_stylus()). Pen frames carry
+ * the report arrival time in MSC_TIMESTAMP (microseconds, wrapping).
+ */
+static void q11k_report_pen_frame(q11k_state_t* st, const q11k_config_t* cfg, const q11k_pen_frame_t* frame, u64 now)
+{
+    q11k_pen_frame_t* last = &st->pen.reported;
+    bool pen_changed = false;
+    bool stylus_changed = false;
+    unsigned int stylus_devs = 0;
+
+    if (frame->stylus != last->stylus)
+    {
+        stylus_devs |= q11k_report_stylus(st, cfg, 0, frame->stylus);
+        stylus_changed = true;
+    }
+
+    if (frame->stylus2 != last->stylus2)
+    {
+        stylus_devs |= q11k_report_stylus(st, cfg, 1, frame->stylus2);
+        stylus_changed = true;
+    }
+
+    if (frame->prox != last->prox)
+    {
+        bool in_range = (frame->prox != Q11K_PROX_OUT);
+        bool touch = (frame->prox == Q11K_PROX_CONTACT);
+
+        trace_q11k_pen_prox(st, frame->prox);
+        if (in_range != (last->prox != Q11K_PROX_OUT))
+        {
+            q11k_sink_key(st, Q11K_INPUT_PEN, BTN_TOOL_PEN, in_range);
+        }
+        if (touch != (last->prox == Q11K_PROX_CONTACT))
+        {
+            q11k_sink_key(st, Q11K_INPUT_PEN, BTN_TOUCH, touch);
+        }
+        pen_changed = true;
+    }
+
+    if (frame->pressure != last->pressure)
+    {
+        q11k_sink_abs(st, Q11K_INPUT_PEN, ABS_PRESSURE, frame->pressure);
+        pen_changed = true;
+    }
+
+    if (frame->x != last->x)
+    {
+        q11k_sink_abs(st, Q11K_INPUT_PEN, ABS_X, frame->x);
+        pen_changed = true;
+    }
+
+    if (frame->y != last->y)
+    {
+        q11k_sink_abs(st, Q11K_INPUT_PEN, ABS_Y, frame->y);
+        pen_changed = true;
+    }
+
+    *last = *frame;
+
+    pen_changed |= (stylus_devs & (1u << Q11K_INPUT_PEN)) != 0;
+    if (stylus_devs & (1u << Q11K_INPUT_KEYBOARD))
+    {
+        q11k_sink_sync(st, Q11K_INPUT_KEYBOARD, now);
+    }
+
+    if (pen_changed)
+    {
+        q11k_sink_msc(st, Q11K_INPUT_PEN, MSC_TIMESTAMP, (int)(u32)div_u64(now, 1000));
+        q11k_sink_sync(st, Q11K_INPUT_PEN, now);
+    }
+
+    /* stylus buttons routed to the keyboard still change the frame */
+    if (pen_changed || stylus_changed)
+    {
+        q11k_sink_pen_frame(st, last, now);
+    }
+}
+
+/*
+ * Press or release stylus @button. The route is only read on a press,
+ * so the report path pays nothing for it, and a release follows its
+ * press even if the mode changed in between. On the keyboard the button
+ * shares keys_down with the pad, whose gestures may hold the same code.
+ * Returns the bit of the device it went to, 0 if nothing was emitted.
+ */
+static unsigned int q11k_report_stylus(q11k_state_t* st, const q11k_config_t* cfg, int button, bool value)
+{
+    const q11k_stylus_route_t* route;
+
+    if (value)
+    {
+        st->pen.stylus_held[button] = &q11k_stylus_routes[cfg->stylus_mode];
+    }
+    route = st->pen.stylus_held[button];
+
+    if (route->idev == Q11K_INPUT_KEYBOARD)
+    {
+        return q11k_report_pad_key(st, route->key[button], value) ? 1u << route->idev : 0;
+    }
+
+    q11k_sink_key(st, route->idev, route->key[button], value);
+    return 1u << route->idev;
+}
+
+void q11k_calculate_pen_data(const u8* data, int* x_pos, int* y_pos, int* pressure)
+{
+    *x_pos           = q11k_decode_field(data, Q11K_REPORT_X, MAX_ABS_X);
+    *y_pos           = q11k_decode_field(data, Q11K_REPORT_Y, MAX_ABS_Y);
+    *pressure        = q11k_decode_field(data, Q11K_REPORT_PRESSURE, MAX_ABS_PRESSURE);
+}
+
+void q11k_calculate_mouse_data(const u8* data, int* x_pos, int* y_pos)
+{
+    *x_pos           = q11k_decode_field(data, Q11K_REPORT_X, MAX_ABS_X);
+    *y_pos           = q11k_decode_field(data, Q11K_REPORT_Y, MAX_ABS_Y);
+}
+
+/*
+ * Pad side: flip the mode bit. The pen state belongs to the other
+ * interface, which picks the change up on its next report.
+ */
+static void q11k_relative_pen_toggle(q11k_state_t* st)
+{
+    int old = atomic_fetch_xor(Q11K_MODE_RELATIVE, &st->modes);
+
+    trace_q11k_relative_toggle(st, !(old & Q11K_MODE_RELATIVE));
+}
+
+/* Pen side: follow the mode bit, starting over from the last position */
+static void q11k_relative_pen_sync(q11k_state_t* st)
+{
+    bool want = (atomic_read(&st->modes) & Q11K_MODE_RELATIVE) != 0;
+
+    if (want == q11k_relative_pen_is_enabled(st))
+    {
+        return;
+    }
+
+    if (want)
+    {
+        q11k_relative_pen_enable(st);
+    }
+    else
+    {
+        q11k_relative_pen_disable(st);
+    }
+}
+
+static bool q11k_relative_pen_is_enabled(q11k_state_t* st)
+{
+    return st->pen.rel_pen_data.enabled;
+}
+
+static void q11k_relative_pen_enable(q11k_state_t* st)
+{
+    q11k_relative_pen_reset_origin(st);
+    q11k_relative_pen_reset_last_abs_pos(st);
+
+    st->pen.rel_pen_data.enabled = true;
+}
+
+static void q11k_relative_pen_disable(q11k_state_t* st)
+{
+    st->pen.rel_pen_data.enabled = false;
+}
+
+static void q11k_relative_pen_reset_origin(q11k_state_t* st)
+{
+    q11k_relative_pen_update_origin(st,
+                                    (s64)st->pen.reported.x << REL_PEN_SHIFT,
+                                    (s64)st->pen.reported.y << REL_PEN_SHIFT);
+}
+
+static void q11k_relative_pen_update_origin(q11k_state_t* st, s64 x, s64 y)
+{
+    st->pen.rel_pen_data.origin_x = x;
+    st->pen.rel_pen_data.origin_y = y;
+}
+
+/* The cursor stays inside the output range of the active area */
+static void q11k_relative_pen_limit_xy(const q11k_config_t* cfg, s64* xp, s64* yp)
+{
+    const q11k_area_matrix_t* m = &cfg->area_matrix;
+    const s64 max_x = (s64)m->max_x << REL_PEN_SHIFT;
+    const s64 max_y = (s64)m->max_y << REL_PEN_SHIFT;
+
+    if (*xp > max_x)
+    {
+        *xp = max_x;
+    }
+    else if (*xp < 0)
+    {
+        *xp = 0;
+    }
+
+    if (*yp > max_y)
+    {
+        *yp = max_y;
+    }
+    else if (*yp < 0)
+    {
+        *yp = 0;
+    }
+}
+
+static void q11k_relative_pen_check_and_try_reset_last_abs_pos(q11k_state_t* st, const q11k_relative_params_t* p, u64 now)
+{
+    u64 dt = now - st->pen.rel_pen_data.last_ns;
+
+    if (dt > (u64)p->gap_ms * 1000000)
+    {
+        q11k_relative_pen_reset_last_abs_pos(st);
+    }
+}
+
+static void q11k_relative_pen_reset_last_abs_pos(q11k_state_t* st)
+{
+    st->pen.rel_pen_data.last_x = -1;
+    st->pen.rel_pen_data.last_y = -1;
+    st->pen.rel_pen_data.reseting_count = REL_PEN_POS_RESET_SKIP_COUNT + 1;
+}
+
+static void q11k_relative_pen_update_last_abs_pos(q11k_state_t* st, int x, int y, u64 now)
+{
+    if (st->pen.rel_pen_data.reseting_count > 0)
+    {
+        --st->pen.rel_pen_data.reseting_count;
+    }
+
+    st->pen.rel_pen_data.last_x = x;
+    st->pen.rel_pen_data.last_y = y;
+    st->pen.rel_pen_data.last_ns = now;
+}
+
+/*
+ * Gain in permille for a motion of (@dx, @dy) since the last sample:
+ * gain + accel * speed, capped at max_gain. Speed is in counts/ms, with
+ * |v| ~ max + 3/8 min instead of a square root.
+ */
+static u32 q11k_relative_pen_gain(q11k_state_t* st, const q11k_relative_params_t* p, int dx, int dy, u64 now)
+{
+    u32 gain = p->gain;
+    u32 accel = p->accel;
+    u32 max_gain = p->max_gain;
+    u64 dt = now - st->pen.rel_pen_data.last_ns;
+    u32 adx = (dx < 0) ? -dx : dx;
+    u32 ady = (dy < 0) ? -dy : dy;
+    u64 dist, speed, accel_gain;
+
+    if (accel == 0 || dt == 0)
+    {
+        return gain;
+    }
+
+    /* the gap check bounds dt by gap_ms, so it fits the 32 bit divisor */
+    dist = (adx > ady) ? adx + ady * 3 / 8 : ady + adx * 3 / 8;
+    speed = div_u64(dist * 1000000, (u32)dt);
+    accel_gain = gain + speed * accel;
+
+    if (accel_gain > max_gain)
+    {
+        return (max_gain > gain) ? max_gain : gain;
+    }
+    return (u32)accel_gain;
+}
+
+/* Cursor motion in Q16 counts; the fraction is kept by the caller */
+static void q11k_relative_pen_get_rel_pos(q11k_state_t* st, const q11k_relative_params_t* p, int abs_x, int abs_y, u64 now, s64* rel_x, s64* rel_y)
+{
+    int dx = 0;
+    int dy = 0;
+    u32 gain;
+
+    if (st->pen.rel_pen_data.reseting_count > 0)
+    {
+        *rel_x = 0;
+        *rel_y = 0;
+        return;
+    }
+
+    dx = abs_x - st->pen.rel_pen_data.last_x;
+    dy = abs_y - st->pen.rel_pen_data.last_y;
+    gain = q11k_relative_pen_gain(st, p, dx, dy, now);
+
+    *rel_x = div_s64((s64)dx * gain * (1 << REL_PEN_SHIFT), 1000);
+    *rel_y = div_s64((s64)dy * gain * (1 << REL_PEN_SHIFT), 1000);
+}
@@ -0,0 +1,507 @@
+/*
+ * Hardware independent part of the Huion Q11K driver.
+ *
+ * Report parsing and all state transitions live here, so the same code is
+ * built into the kernel module and into the userspace tools (see tools/).
+ * The core never touches struct input_dev: every event goes out through
+ * an event sink supplied by the caller.
+ */
+#ifndef __Q11K_CORE_H
+#define __Q11K_CORE_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/cache.h>
+#include <linux/errno.h>
+#include <asm/barrier.h>
+#include <linux/atomic.h>
+#include <linux/input.h>
+#include <linux/math64.h>
+#include <linux/rcupdate.h>
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 12, 0)
+#include <linux/unaligned.h>
+#else
+#include <asm/unaligned.h>
+#endif
+
+#define Q11K_CACHE_ALIGNED ____cacheline_aligned_in_smp
+#else
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/input-event-codes.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int32_t  s32;
+typedef int64_t  s64;
+
+#define Q11K_CACHE_ALIGNED __attribute__((aligned(64)))
+
+static inline u16 get_unaligned_le16(const void* p)
+{
+    const u8* b = p;
+    return (u16)(b[0] | (b[1] << 8));
+}
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+    return dividend / divisor;
+}
+
+static inline s64 div_s64(s64 dividend, s32 divisor)
+{
+    return dividend / divisor;
+}
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+    return dividend / divisor;
+}
+
+#define ARRAY_SIZE(a)       (sizeof(a) / sizeof((a)[0]))
+
+#define READ_ONCE(x)        (*(const volatile __typeof__(x)*)&(x))
+#define WRITE_ONCE(x, v)    (*(volatile __typeof__(x)*)&(x) = (v))
+
+#define smp_load_acquire(p)         __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)     __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#define __rcu
+#define rcu_dereference(p)          __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcu_assign_pointer(p, v)    __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#define RCU_INIT_POINTER(p, v)      ((p) = (v))
+
+typedef struct { int counter; } atomic_t;
+
+#define atomic_read(v)              __atomic_load_n(&(v)->counter, __ATOMIC_RELAXED)
+#define atomic_set(v, i)            __atomic_store_n(&(v)->counter, (i), __ATOMIC_RELAXED)
+#define atomic_inc(v)               __atomic_fetch_add(&(v)->counter, 1, __ATOMIC_RELAXED)
+#define atomic_fetch_xor(i, v)      __atomic_fetch_xor(&(v)->counter, (i), __ATOMIC_SEQ_CST)
+#define atomic_fetch_or(i, v)       __atomic_fetch_or(&(v)->counter, (i), __ATOMIC_SEQ_CST)
+#define atomic_fetch_andnot(i, v)   __atomic_fetch_and(&(v)->counter, ~(i), __ATOMIC_SEQ_CST)
+#endif
+
+#define Q11K_REPORT_ID                  0x08
+#define Q11K_REPORT_SIZE                12
+#define Q11K_REPORT_HEADER_SIZE         2       /* report ID + type byte */
+#define Q11K_REPORT_TYPES               256
+#define Q11K_REPORT_IDS                 256
+
+/* Little-endian 16 bit fields of pen (0x8x) and mouse (0x90) reports */
+#define Q11K_REPORT_X                   2
+#define Q11K_REPORT_Y                   4
+#define Q11K_REPORT_PRESSURE            6
+
+#define MAX_ABS_X 50800
+#define MAX_ABS_Y 31750
+#define MAX_ABS_PRESSURE 8192
+
+#define REL_PEN_POS_RESET_SKIP_COUNT 1
+
+/* Relative mode defaults, see q11k_relative_params_t */
+#define REL_PEN_DEF_GAIN        1000
+#define REL_PEN_DEF_ACCEL       0
+#define REL_PEN_DEF_MAX_GAIN    4000
+#define REL_PEN_DEF_GAP_MS      40
+
+#define REL_PEN_MAX_GAIN        100000
+#define REL_PEN_MAX_GAP_MS      1000
+#define REL_PEN_SHIFT           16
+
+#define Q11K_KEY_TOP_LEFT KEY_LEFTBRACE
+#define Q11K_KEY_TOP_MIDDLE KEY_RIGHTBRACE
+#define Q11K_KEY_TOP_RIGHT KEY_COMMA
+#define Q11K_KEY_BOTTOM_LEFT KEY_DOT
+#define Q11K_KEY_BOTTOM_MIDDLE KEY_SLASH
+#define Q11K_KEY_BOTTOM_RIGHT KEY_BACKSLASH
+#define Q11K_KEY_6 KEY_SEMICOLON
+#define Q11K_KEY_7 KEY_APOSTROPHE
+
+#define Q11K_VKEY_1_CLICK BTN_LEFT
+#define Q11K_VKEY_2_CLICK BTN_RIGHT
+#define Q11K_VKEY_4_CLICK KEY_ESC
+
+#define Q11K_VKEY_2_UP       KEY_KPPLUS
+#define Q11K_VKEY_2_DOWN     KEY_KPMINUS
+#define Q11K_VKEY_2_LEFT     KEY_F16
+#define Q11K_VKEY_2_RIGHT    KEY_F17
+
+#define Q11K_VKEY_3_UP       KEY_F18
+#define Q11K_VKEY_3_DOWN     KEY_F19
+#define Q11K_VKEY_3_LEFT     KEY_F20
+#define Q11K_VKEY_3_RIGHT    KEY_F21
+
+#define Q11K_VKEY_4_MOVE       KEY_F22
+
+/*
+ * Pad scancodes: the raw byte of a 0xe0 (keys) or 0xe1 (touch strip)
+ * report, with the strip codes moved to the second half of the table.
+ * The defaults above only seed the per-device keymap, which can be
+ * changed at runtime with EVIOCSKEYCODE (setkeycodes, udev hwdb).
+ */
+#define Q11K_KEYMAP_SIZE            512
+#define Q11K_SCAN_KEY(raw)          ((unsigned int)(raw))
+#define Q11K_SCAN_GESTURE(raw)      (0x100 | (unsigned int)(raw))
+
+#define Q11K_PAD_MODIFIER_COUNT     2
+
+/*
+ * Scroll mode of the touch strip, see q11k_scroll_params_t. One notch is
+ * one 0xe1 report; a wheel detent is 120 hi-res units.
+ */
+#define Q11K_SCROLL_DETENT          120
+#define Q11K_SCROLL_DEF_STEP        30
+#define Q11K_SCROLL_DEF_ACCEL       20
+#define Q11K_SCROLL_DEF_MAX_STEP    240
+#define Q11K_SCROLL_MAX_STEP        (Q11K_SCROLL_DETENT * 16)
+#define Q11K_SCROLL_MAX_ACCEL       1000
+/* a longer pause between notches starts a new swipe at rest speed */
+#define Q11K_SCROLL_GAP_NS          200000000
+
+/*
+ * The tablet streams reports while the pen is in range. After this long
+ * without one the pen is taken out of range, see q11k_core_pen_release().
+ */
+#define Q11K_PROX_DEF_TIMEOUT_MS    100
+#define Q11K_PROX_MAX_TIMEOUT_MS    10000
+
+/*
+ * Most events the core puts into one frame of each input device,
+ * SYN_REPORT included: pen tool, touch, two stylus buttons, pressure, x,
+ * y and MSC_TIMESTAMP; a pad key switch (old key up, MSC_SCAN, two
+ * modifiers and the new key down); a hi-res and a detent wheel event on
+ * the scroll device.
+ */
+#define Q11K_PEN_FRAME_EVENTS           9
+#define Q11K_KEYBOARD_FRAME_EVENTS      6
+#define Q11K_SCROLL_FRAME_EVENTS        3
+
+#include "q11k_filter.h"
+#include "q11k_deadband.h"
+#include "q11k_area.h"
+#include "q11k_pressure.h"
+
+/* Interfaces of the tablet, by bInterfaceNumber */
+enum q11k_iface
+{
+    Q11K_IFACE_PAD = 0,
+    Q11K_IFACE_PEN,
+    Q11K_IFACE_COUNT
+};
+
+/* Input devices the core reports to */
+enum q11k_input
+{
+    Q11K_INPUT_PEN = 0,
+    Q11K_INPUT_KEYBOARD,
+    Q11K_INPUT_SCROLL,
+    Q11K_INPUT_COUNT
+};
+
+/* Where the two stylus buttons go, an index into q11k_stylus_routes */
+enum q11k_stylus_mode
+{
+    Q11K_STYLUS_PEN = 0,        /* BTN_STYLUS / BTN_STYLUS2 on the pen */
+    Q11K_STYLUS_MOUSE,          /* BTN_MIDDLE / BTN_RIGHT on the keyboard */
+    Q11K_STYLUS_MODES
+};
+
+/*
+ * Pen proximity: BTN_TOOL_PEN is down while the pen is in range and
+ * BTN_TOUCH while it touches the surface.
+ */
+enum q11k_pen_prox
+{
+    Q11K_PROX_OUT = 0,
+    Q11K_PROX_IN,
+    Q11K_PROX_CONTACT
+};
+
+typedef struct __tag_q11k_stylus_route_t
+{
+    enum q11k_input idev;
+    unsigned short key[2];
+} q11k_stylus_route_t;
+
+
+/*
+ * Tunables of the relative mode, part of q11k_config_t. The cursor moves
+ * by pen motion * gain, where gain grows linearly with pen speed up to
+ * max_gain.
+ */
+typedef struct __tag_q11k_relative_params_t
+{
+    u32 gain;           /* permille of pen motion at rest */
+    u32 accel;          /* permille added per count/ms of pen speed */
+    u32 max_gain;       /* permille cap of the accelerated gain */
+    u32 gap_ms;         /* no sample for this long means the pen was lifted */
+} q11k_relative_params_t;
+
+/* Written only from the pen interface's report path */
+typedef struct __tag_relative_pen_t
+{
+    /* the pen path's copy of Q11K_MODE_RELATIVE, see q11k_state_t */
+    bool enabled;
+    int last_x;
+    int last_y;
+
+    /* cursor position, Q16 so that sub-count motion accumulates */
+    s64 origin_x;
+    s64 origin_y;
+
+    int reseting_count;
+
+    u64 last_ns;
+} relative_pen_t;
+
+/*
+ * Everything the pen reports in one frame. The core keeps the last frame
+ * it emitted and only sends the fields that changed.
+ */
+typedef struct __tag_q11k_pen_frame_t
+{
+    enum q11k_pen_prox prox;
+    bool stylus;
+    bool stylus2;
+    int pressure;
+    int x;
+    int y;
+} q11k_pen_frame_t;
+
+/*
+ * Event sink. The kernel module forwards these to input_report_*() and
+ * input_sync(), the userspace tools count or re-emit them. @time_ns of
+ * sync is the arrival time of the report that produced the frame.
+ * pen_frame, if set, gets every pen frame that changed after its events
+ * went out, whole.
+ */
+struct q11k_sink_ops
+{
+    void (*report_key)(void* ctx, enum q11k_input idev, unsigned int code, int value);
+    void (*report_abs)(void* ctx, enum q11k_input idev, unsigned int code, int value);
+    void (*report_msc)(void* ctx, enum q11k_input idev, unsigned int code, int value);
+    void (*report_rel)(void* ctx, enum q11k_input idev, unsigned int code, int value);
+    void (*sync)(void* ctx, enum q11k_input idev, u64 time_ns);
+    void (*pen_frame)(void* ctx, const q11k_pen_frame_t* frame, u64 time_ns);
+};
+
+/* Written only from the pen interface's report path */
+typedef struct __tag_q11k_pen_state_t
+{
+    q11k_pen_frame_t reported;
+
+    /* arrival of the last pen report */
+    u64 last_ns;
+
+    /* the stylus route each held button was pressed on, so that its
+       release goes to the same place */
+    const q11k_stylus_route_t* stylus_held[2];
+
+    q11k_filter_t filter;
+    q11k_deadband_t deadband;
+    relative_pen_t rel_pen_data;
+} q11k_pen_state_t;
+
+/* Tunables of the strip scroll mode, part of q11k_config_t */
+typedef struct __tag_q11k_scroll_params_t
+{
+    u32 enabled;        /* strip swipes scroll instead of pressing keys */
+    u32 three_finger;   /* three finger swipes (0x22-0x25) scroll too */
+    u32 step;           /* hi-res units per notch at rest */
+    u32 accel;          /* permille of step added per notch/s of swipe speed */
+    u32 max_step;       /* cap of the accelerated step */
+} q11k_scroll_params_t;
+
+typedef struct __tag_q11k_scroll_state_t
+{
+    u8 last_raw;
+    u64 last_ns;
+    /* hi-res units not yet reported as a REL_WHEEL/REL_HWHEEL detent */
+    int remainder[2];
+} q11k_scroll_state_t;
+
+/* Written only from the pad interface's report path, except keys_down */
+typedef struct __tag_q11k_pad_state_t
+{
+    unsigned short last_key;
+    unsigned short last_vkey;
+    /* strip touched without a mapped gesture held (toggle or unmapped) */
+    bool strip_held;
+
+    /* keys held down on the keyboard device, by the pad and by stylus
+       buttons routed there; atomic since both interfaces update it */
+    atomic_t keys_down[(KEY_CNT + 31) / 32];
+
+    /* scancode -> keycode, see Q11K_SCAN_KEY() / Q11K_SCAN_GESTURE() */
+    unsigned short keymap[Q11K_KEYMAP_SIZE];
+
+    q11k_scroll_state_t scroll;
+} q11k_pad_state_t;
+
+/*
+ * Reports the core dropped, to spot firmware variants in the field. Both
+ * interfaces bump these concurrently, hence atomic_t.
+ */
+typedef struct __tag_q11k_report_stats_t
+{
+    atomic_t foreign[Q11K_REPORT_IDS];      /* by report ID, not Q11K_REPORT_ID */
+    atomic_t truncated;                     /* too short for its handler */
+    atomic_t misrouted;                     /* on the other interface */
+    atomic_t unhandled[Q11K_REPORT_TYPES];  /* by type byte, no handler */
+} q11k_report_stats_t;
+
+/*
+ * Tunables of a tablet. A published config is never modified: the report
+ * path picks up the current one once per report, under the RCU read lock
+ * its caller holds around q11k_core_raw_event(), and writers replace it
+ * whole (see q11k_config_publish() in q11k_hid.c). All knobs are u32 for
+ * the sysfs accessor.
+ */
+typedef struct __tag_q11k_config_t
+{
+    q11k_filter_params_t filter;
+    q11k_deadband_params_t deadband;
+    q11k_area_params_t area;
+    q11k_area_matrix_t area_matrix;         /* compiled from @area */
+    q11k_relative_params_t relative;
+    q11k_scroll_params_t scroll;
+
+    /* silence that ends the proximity, 0 = never */
+    u32 prox_timeout_ms;
+    /* where stylus buttons go from their next press on, below Q11K_STYLUS_MODES */
+    u32 stylus_mode;
+
+    /* pressure curve, NULL for linear. A config that replaces one with
+       the same curve takes it over; the live config owns it */
+    const q11k_pressure_lut_t* pressure;
+} q11k_config_t;
+
+/* Mode bits of q11k_state_t.modes */
+#define Q11K_MODE_RELATIVE          0x01    /* pen moves the cursor relatively */
+
+/*
+ * Per tablet state. Pen and pad reports arrive on different interfaces,
+ * so their halves live on separate cache lines. @modes is flipped from
+ * one interface and acted on from the other, so it is atomic; the pen
+ * path keeps its own copy and resets its state when they differ.
+ */
+typedef struct __tag_q11k_state_t
+{
+    const struct q11k_sink_ops* ops;
+    void* ctx;
+    q11k_config_t __rcu* config;
+    atomic_t modes;
+
+    q11k_pen_state_t pen Q11K_CACHE_ALIGNED;
+    q11k_pad_state_t pad Q11K_CACHE_ALIGNED;
+
+    q11k_report_stats_t stats Q11K_CACHE_ALIGNED;
+
+    /* what @config points to until the first replacement; userspace
+       tools edit it in place before the first report */
+    q11k_config_t default_config;
+} q11k_state_t;
+
+extern const unsigned short q11k_pad_modifiers[Q11K_PAD_MODIFIER_COUNT];
+extern const unsigned short q11k_default_keymap[Q11K_KEYMAP_SIZE];
+extern const q11k_stylus_route_t q11k_stylus_routes[Q11K_STYLUS_MODES];
+
+/* Defaults, with the area matrix compiled */
+void q11k_config_init(q11k_config_t* cfg);
+
+void q11k_core_init(q11k_state_t* st, const struct q11k_sink_ops* ops, void* ctx);
+
+/* The live config; under the RCU read lock in the kernel */
+static inline const q11k_config_t* q11k_core_config(q11k_state_t* st)
+{
+    return rcu_dereference(st->config);
+}
+
+/*
+ * Time the pen leaves range without another report, 0 while it is out of
+ * range or the timeout is off. Called from the same context as the report
+ * path, or with it excluded, and under the RCU read lock.
+ */
+u64 q11k_core_pen_deadline(q11k_state_t* st);
+
+/*
+ * Take the pen out of range: release its buttons, BTN_TOUCH and
+ * BTN_TOOL_PEN. For a tablet that went silent mid-stroke; same calling
+ * rules as q11k_core_pen_deadline().
+ */
+void q11k_core_pen_release(q11k_state_t* st, u64 now);
+
+/*
+ * Feed one raw HID report to the core. @now is the arrival time in
+ * monotonic nanoseconds, used for gap detection by the filter and the
+ * relative pen mode. Returns true if the report was recognized; dropped
+ * reports are counted in st->stats.
+ *
+ * A report produces at most one frame (one sync) per input device, and
+ * only events whose value actually changed.
+ */
+bool q11k_core_raw_event(q11k_state_t* st, const u8* data, int size, u64 now);
+
+/*
+ * q11k_core_raw_event() for a report that arrived on @iface. Pen and pad
+ * state each have a single writer, the report path of their interface, so
+ * a report type seen on the other interface is dropped (and counted).
+ */
+bool q11k_core_iface_event(q11k_state_t* st, enum q11k_iface iface, const u8* data, int size, u64 now);
+
+static inline int q11k_decode_le16(const u8* data, int offset)
+{
+    return get_unaligned_le16(data + offset);
+}
+
+/* A field limited to the range the input device advertises, 0..@max */
+static inline int q11k_decode_field(const u8* data, int offset, int max)
+{
+    int v = q11k_decode_le16(data, offset);
+
+    return (v > max) ? max : v;
+}
+
+void q11k_calculate_pen_data(const u8* data, int* x_pos, int* y_pos, int* pressure);
+void q11k_calculate_mouse_data(const u8* data, int* x_pos, int* y_pos);
+
+static inline void q11k_sink_key(q11k_state_t* st, enum q11k_input idev, unsigned int code, int value)
+{
+    st->ops->report_key(st->ctx, idev, code, value);
+}
+
+static inline void q11k_sink_abs(q11k_state_t* st, enum q11k_input idev, unsigned int code, int value)
+{
+    st->ops->report_abs(st->ctx, idev, code, value);
+}
+
+static inline void q11k_sink_msc(q11k_state_t* st, enum q11k_input idev, unsigned int code, int value)
+{
+    st->ops->report_msc(st->ctx, idev, code, value);
+}
+
+static inline void q11k_sink_rel(q11k_state_t* st, enum q11k_input idev, unsigned int code, int value)
+{
+    st->ops->report_rel(st->ctx, idev, code, value);
+}
+
+static inline void q11k_sink_sync(q11k_state_t* st, enum q11k_input idev, u64 time_ns)
+{
+    st->ops->sync(st->ctx, idev, time_ns);
+}
+
+static inline void q11k_sink_pen_frame(q11k_state_t* st, const q11k_pen_frame_t* frame, u64 time_ns)
+{
+    if (st->ops->pen_frame != NULL)
+    {
+        st->ops->pen_frame(st->ctx, frame, time_ns);
+    }
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "q11k_core.h"
+
+/*
+ * Two states with hysteresis. Moving, every sample passes through; after
+ * @settle samples in a row that moved at most half the radius the pen
+ * rests and its position is held. Resting, a sample that lands more than
+ * the radius away from the held position is reported as is and the pen
+ * moves again, so motion is never delayed, only the first radius of it
+ * is absorbed.
+ *
+ * The radius adapts to the pen: it is three times the mean jitter step
+ * measured at rest, capped by the hover or contact radius. A quiet pen
+ * gets a tight deadband, a noisy one up to the configured maximum.
+ */
+
+static int q11k_deadband_dist(int ax, int ay, int bx, int by)
+{
+    int dx = (ax > bx) ? ax - bx : bx - ax;
+    int dy = (ay > by) ? ay - by : by - ay;
+
+    return (dx > dy) ? dx : dy;
+}
+
+static u32 q11k_deadband_radius(const q11k_deadband_t* d, const q11k_deadband_params_t* p)
+{
+    u32 max = d->contact ? p->contact_radius : p->hover_radius;
+    u32 r = (3 * d->noise) >> Q11K_DEADBAND_NOISE_SHIFT;
+
+    if (r < 1)
+    {
+        r = 1;
+    }
+    return (r > max) ? max : r;
+}
+
+void q11k_deadband_defaults(q11k_deadband_params_t* p)
+{
+    p->enabled = 1;
+    p->hover_radius = Q11K_DEADBAND_DEF_HOVER;
+    p->contact_radius = Q11K_DEADBAND_DEF_CONTACT;
+    p->pressure = Q11K_DEADBAND_DEF_PRESSURE;
+    p->settle = Q11K_DEADBAND_DEF_SETTLE;
+}
+
+void q11k_deadband_reset(q11k_deadband_t* d)
+{
+    d->primed = false;
+    d->resting = false;
+    d->contact = false;
+    d->still = 0;
+    d->last_now = 0;
+    d->x = 0;
+    d->y = 0;
+    d->pressure = 0;
+    d->last_x = 0;
+    d->last_y = 0;
+    d->noise = 0;
+}
+
+void q11k_deadband_apply(q11k_deadband_t* d, const q11k_deadband_params_t* p,
+                         int* x, int* y, int* pressure, bool contact, u64 now)
+{
+    int step;
+    u32 r;
+
+    if (!p->enabled)
+    {
+        d->primed = false;
+        return;
+    }
+
+    step = q11k_deadband_dist(*x, *y, d->last_x, d->last_y);
+    d->last_x = *x;
+    d->last_y = *y;
+
+    if (!d->primed || now - d->last_now > Q11K_DEADBAND_GAP_NS || contact != d->contact)
+    {
+        /* new stroke, touch down or lift: report exactly where it happened;
+           until jitter is measured the radius is the configured maximum */
+        if (!d->primed)
+        {
+            d->noise = Q11K_DEADBAND_MAX_RADIUS << Q11K_DEADBAND_NOISE_SHIFT;
+        }
+        d->primed = true;
+        d->resting = false;
+        d->contact = contact;
+        d->still = 0;
+        d->last_now = now;
+        d->x = *x;
+        d->y = *y;
+        d->pressure = (pressure != NULL) ? *pressure : 0;
+        return;
+    }
+    d->last_now = now;
+
+    r = q11k_deadband_radius(d, p);
+
+    if (!d->resting)
+    {
+        d->x = *x;
+        d->y = *y;
+        if (pressure != NULL)
+        {
+            d->pressure = *pressure;
+        }
+
+        if ((u32)step * 2 <= r)
+        {
+            if (++d->still >= p->settle)
+            {
+                d->resting = true;
+            }
+        }
+        else
+        {
+            d->still = 0;
+        }
+        return;
+    }
+
+    if ((u32)q11k_deadband_dist(*x, *y, d->x, d->y) > r)
+    {
+        d->resting = false;
+        d->still = 0;
+        d->x = *x;
+        d->y = *y;
+    }
+    else
+    {
+        /* jitter: learn its size and hold the position */
+        d->noise = (u32)((s32)d->noise + ((step << Q11K_DEADBAND_NOISE_SHIFT) - (s32)d->noise) / 8);
+        *x = d->x;
+        *y = d->y;
+    }
+
+    /* pressure of a resting pen, never across zero */
+    if (pressure != NULL)
+    {
+        int dp = *pressure - d->pressure;
+
+        if (d->resting && *pressure != 0 && d->pressure != 0 &&
+            dp <= (int)p->pressure && -dp <= (int)p->pressure)
+        {
+            *pressure = d->pressure;
+        }
+        else
+        {
+            d->pressure = *pressure;
+        }
+    }
+}
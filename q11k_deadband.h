@@ -0,0 +1,64 @@
+/*
+ * Jitter deadband of the pen: while the pen rests, its reported position
+ * (and pressure) stays put until the sample moves out of a small radius,
+ * so a hovering pen stops streaming noise. Included by q11k_core.h.
+ */
+#ifndef __Q11K_DEADBAND_H
+#define __Q11K_DEADBAND_H
+
+#define Q11K_DEADBAND_DEF_HOVER     8       /* counts */
+#define Q11K_DEADBAND_DEF_CONTACT   2       /* counts */
+#define Q11K_DEADBAND_DEF_PRESSURE  4
+#define Q11K_DEADBAND_DEF_SETTLE    3       /* samples, ~13 ms at 233 PPS */
+
+#define Q11K_DEADBAND_MAX_RADIUS    256
+#define Q11K_DEADBAND_MAX_PRESSURE  256
+#define Q11K_DEADBAND_MAX_SETTLE    64
+
+/* A gap this long between samples starts over with the pen moving */
+#define Q11K_DEADBAND_GAP_NS        20000000
+
+/* Noise estimate in 1/16 counts */
+#define Q11K_DEADBAND_NOISE_SHIFT   4
+
+/* Tunables, part of q11k_config_t; u32 for the sysfs accessor */
+typedef struct __tag_q11k_deadband_params_t
+{
+    u32 enabled;
+    u32 hover_radius;       /* largest radius while in range, counts */
+    u32 contact_radius;     /* largest radius on the surface, counts */
+    u32 pressure;           /* pressure change ignored at rest */
+    u32 settle;             /* slow samples before the pen counts as resting */
+} q11k_deadband_params_t;
+
+typedef struct __tag_q11k_deadband_t
+{
+    bool primed;
+    bool resting;
+    bool contact;
+    u32 still;              /* slow samples in a row while moving */
+    u64 last_now;
+
+    /* reported position and pressure (the anchor while resting), the
+       previous sample and the sample to sample jitter seen at rest */
+    int x;
+    int y;
+    int pressure;
+    int last_x;
+    int last_y;
+    u32 noise;
+} q11k_deadband_t;
+
+void q11k_deadband_defaults(q11k_deadband_params_t* p);
+
+/* Forget the pen, e.g. when it leaves range */
+void q11k_deadband_reset(q11k_deadband_t* d);
+
+/*
+ * Filter one sample in place. @pressure is NULL for reports without a
+ * pressure reading; @contact selects the radius. A no-op while disabled.
+ */
+void q11k_deadband_apply(q11k_deadband_t* d, const q11k_deadband_params_t* p,
+                         int* x, int* y, int* pressure, bool contact, u64 now);
+
+#endif
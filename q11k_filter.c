@@ -0,0 +1,126 @@
+#include "q11k_core.h"
+
+/*
+ * 1-euro filter (Casiez et al.): an exponential low pass whose cutoff
+ * rises with pen speed, so slow strokes lose their jitter and fast ones
+ * keep up with the pen. For a sample @dt after the previous one the
+ * smoothing factor of a cutoff fc is alpha = 2*pi*fc*dt / (2*pi*fc*dt + 1).
+ */
+
+/* @dt_ns is at most Q11K_FILTER_GAP_NS, which keeps w * dt below 2^47 */
+static u32 q11k_filter_alpha(u32 cutoff_mhz, u64 dt_ns)
+{
+    u64 wdt = (u64)cutoff_mhz * 6283 / 1000 * dt_ns;
+
+    return (u32)div64_u64(wdt << Q11K_FILTER_SHIFT, wdt + 1000000000000ull);
+}
+
+static s64 q11k_filter_abs64(s64 v)
+{
+    return (v < 0) ? -v : v;
+}
+
+static int q11k_filter_clamp(s64 v, int max)
+{
+    if (v < 0)
+    {
+        return 0;
+    }
+    return (v > max) ? max : (int)v;
+}
+
+void q11k_filter_defaults(q11k_filter_params_t* p)
+{
+    p->enabled = 0;
+    p->rate_hz = Q11K_FILTER_DEF_RATE;
+    p->min_cutoff_mhz = Q11K_FILTER_DEF_MIN_CUTOFF;
+    p->beta = Q11K_FILTER_DEF_BETA;
+    p->d_cutoff_mhz = Q11K_FILTER_DEF_D_CUTOFF;
+    p->predict_us = Q11K_FILTER_DEF_PREDICT;
+}
+
+void q11k_filter_init(q11k_filter_t* f)
+{
+    f->primed = false;
+    f->last_now = 0;
+    f->raw_x = 0;
+    f->raw_y = 0;
+    f->x = 0;
+    f->y = 0;
+    f->dx = 0;
+    f->dy = 0;
+}
+
+void q11k_filter_apply(q11k_filter_t* f, const q11k_filter_params_t* p, int* x, int* y, u64 now)
+{
+    s64 xq = (s64)*x * (1 << Q11K_FILTER_SHIFT);
+    s64 yq = (s64)*y * (1 << Q11K_FILTER_SHIFT);
+    u32 alpha, alpha_d, predict;
+    u64 dt, speed_x, speed_y, speed, cutoff;
+    s64 out_x, out_y;
+
+    if (!p->enabled)
+    {
+        f->primed = false;
+        return;
+    }
+
+    if (!f->primed || now - f->last_now > Q11K_FILTER_GAP_NS)
+    {
+        /* first sample of a stroke: nothing to smooth against yet */
+        f->raw_x = *x;
+        f->raw_y = *y;
+        f->x = xq;
+        f->y = yq;
+        f->dx = 0;
+        f->dy = 0;
+        f->primed = true;
+        f->last_now = now;
+        return;
+    }
+
+    /* the measured interval; the nominal one for reports that arrive
+       with the same timestamp */
+    dt = now - f->last_now;
+    if (dt == 0)
+    {
+        dt = div_u64(1000000000ull, p->rate_hz);
+    }
+    f->last_now = now;
+
+    predict = p->predict_us;
+
+    /* speed estimate from the raw samples, low passed at a fixed cutoff;
+       differencing against the lagging estimate would overstate it */
+    alpha_d = q11k_filter_alpha(p->d_cutoff_mhz, dt);
+    f->dx += (div_s64(((s64)*x - f->raw_x) * 1000000000 * (1 << Q11K_FILTER_SHIFT), (s32)dt) - f->dx) * alpha_d >> Q11K_FILTER_SHIFT;
+    f->dy += (div_s64(((s64)*y - f->raw_y) * 1000000000 * (1 << Q11K_FILTER_SHIFT), (s32)dt) - f->dy) * alpha_d >> Q11K_FILTER_SHIFT;
+    f->raw_x = *x;
+    f->raw_y = *y;
+
+    /* one cutoff for both axes, from |v| ~ max + 3/8 min */
+    speed_x = q11k_filter_abs64(f->dx) >> Q11K_FILTER_SHIFT;
+    speed_y = q11k_filter_abs64(f->dy) >> Q11K_FILTER_SHIFT;
+    speed = (speed_x > speed_y) ? speed_x + speed_y * 3 / 8 : speed_y + speed_x * 3 / 8;
+
+    cutoff = p->min_cutoff_mhz + div_u64(speed * p->beta, 1000);
+    if (cutoff > Q11K_FILTER_MAX_CUTOFF)
+    {
+        cutoff = Q11K_FILTER_MAX_CUTOFF;
+    }
+
+    alpha = q11k_filter_alpha((u32)cutoff, dt);
+    f->x += ((xq - f->x) * alpha) >> Q11K_FILTER_SHIFT;
+    f->y += ((yq - f->y) * alpha) >> Q11K_FILTER_SHIFT;
+
+    out_x = f->x;
+    out_y = f->y;
+    if (predict != 0)
+    {
+        out_x += div_s64(f->dx * predict, 1000000);
+        out_y += div_s64(f->dy * predict, 1000000);
+    }
+
+    *x = q11k_filter_clamp((out_x + (1 << (Q11K_FILTER_SHIFT - 1))) >> Q11K_FILTER_SHIFT, MAX_ABS_X);
+    *y = q11k_filter_clamp((out_y + (1 << (Q11K_FILTER_SHIFT - 1))) >> Q11K_FILTER_SHIFT, MAX_ABS_Y);
+}
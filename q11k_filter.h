@@ -0,0 +1,61 @@
+/*
+ * Pen position filter: a fixed-point 1-euro low pass with optional
+ * constant-velocity prediction. Runs in the report path, so no floating
+ * point and no allocation. Included by q11k_core.h.
+ */
+#ifndef __Q11K_FILTER_H
+#define __Q11K_FILTER_H
+
+#define Q11K_FILTER_SHIFT           16
+
+/* Reports arrive every ~4.3 ms while the pen is in range (233 PPS) */
+#define Q11K_FILTER_DEF_RATE        233
+#define Q11K_FILTER_DEF_MIN_CUTOFF  1000    /* mHz */
+#define Q11K_FILTER_DEF_BETA        1500    /* uHz per count/s */
+#define Q11K_FILTER_DEF_D_CUTOFF    1000    /* mHz */
+#define Q11K_FILTER_DEF_PREDICT     0       /* us */
+
+#define Q11K_FILTER_MAX_RATE        2000
+#define Q11K_FILTER_MAX_CUTOFF      1000000
+#define Q11K_FILTER_MAX_BETA        1000000
+#define Q11K_FILTER_MAX_PREDICT     50000
+
+/* A gap this long between samples restarts the filter */
+#define Q11K_FILTER_GAP_NS          20000000
+
+/*
+ * Tunables, part of q11k_config_t. All of them are u32 so they can share
+ * one sysfs accessor.
+ */
+typedef struct __tag_q11k_filter_params_t
+{
+    u32 enabled;
+    u32 rate_hz;            /* nominal report rate, for reports without a measurable interval */
+    u32 min_cutoff_mhz;     /* cutoff with the pen at rest */
+    u32 beta;               /* cutoff increase per pen speed, uHz per count/s */
+    u32 d_cutoff_mhz;       /* cutoff of the speed estimate */
+    u32 predict_us;         /* how far to extrapolate, 0 = no prediction */
+} q11k_filter_params_t;
+
+typedef struct __tag_q11k_filter_t
+{
+    bool primed;
+    u64 last_now;
+
+    /* last raw sample and the Q16 position (counts) and speed
+       (counts/s) estimates */
+    int raw_x;
+    int raw_y;
+    s64 x;
+    s64 y;
+    s64 dx;
+    s64 dy;
+} q11k_filter_t;
+
+void q11k_filter_defaults(q11k_filter_params_t* p);
+void q11k_filter_init(q11k_filter_t* f);
+
+/* Filter one sample in place; a no-op while the filter is disabled */
+void q11k_filter_apply(q11k_filter_t* f, const q11k_filter_params_t* p, int* x, int* y, u64 now);
+
+#endif
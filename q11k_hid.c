@@ -0,0 +1,2279 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/io.h>
+#include <linux/ioport.h>
+#include <linux/acpi.h>
+#include <linux/device.h>
+#include <linux/interrupt.h>
+#include <linux/input.h>
+#include <linux/delay.h>
+#include <linux/dmi.h>
+#include "compat.h"
+#include "q11k_core.h"
+#include "q11k_record.h"
+#include "q11k_sample.h"
+
+#define CREATE_TRACE_POINTS
+#include "q11k_trace.h"
+#include <linux/version.h>
+#include <linux/hid.h>
+#include <linux/usb.h>
+#include <linux/hrtimer.h>
+#include <linux/idr.h>
+#include <linux/ktime.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/rcupdate.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <stdbool.h>
+
+
+#define	hid_to_usb_dev(hid_dev) container_of(hid_dev->dev.parent->parent, struct usb_device, dev)
+
+#define MODULENAME                     "q11k_device"
+#define DEVNAME                        "Huion Q11K Tablet"
+
+#define USB_VENDOR_ID_HUION		        0x256c
+#define USB_DEVICE_ID_HUION_TABLET	    0x006e
+
+#define Q11K_USB_STRING_SIZE            256
+#define Q11K_PRESSURE_DESC_SIZE         192
+
+/*
+ * evdev gives each client a buffer of 8 packets of the device's
+ * events-per-packet hint. The pen asks for enough to hold this many of
+ * its frames, so a reader that stalls for a few milliseconds at kHz
+ * report rates does not get SYN_DROPPED.
+ */
+#define Q11K_EVDEV_BUF_PACKETS          8
+#define Q11K_PEN_BUFFERED_FRAMES        64
+
+/* log2 histogram buckets: bucket i counts values in [2^(i-1), 2^i) ns */
+#define Q11K_HIST_BUCKETS               40
+
+#define DEBUG
+#define DPRINT(d, ...)       printk(d, ##__VA_ARGS__)
+
+/*
+ * Vendor strings the pad interface exposes. Reading them is also what
+ * switches Huion tablets out of their reduced default mode (0xc8 on the
+ * Q11K), so they are still read on every bind, just not from probe.
+ */
+static const struct
+{
+    u8 index;
+    const char* name;
+} q11k_usb_strings[] = {
+    { 0x02, "0x02" },
+    { 0xc9, "0xc9" },
+    { 0xc8, "0xc8" },
+    { 0xca, "0xca" },
+};
+
+#define Q11K_USB_STRING_COUNT   ARRAY_SIZE(q11k_usb_strings)
+
+/*
+ * Report statistics under debugfs, one copy per CPU so that the report
+ * path never bounces a shared line. Summed when read; a reset racing a
+ * report may lose that report's counts.
+ */
+typedef struct __tag_q11k_debug_stats_t
+{
+    u64 reports[Q11K_REPORT_TYPES];                     /* by type byte */
+    u64 interval[Q11K_IFACE_COUNT][Q11K_HIST_BUCKETS];  /* since the last report */
+    u64 process[Q11K_HIST_BUCKETS];                     /* time in q11k_raw_event() */
+} q11k_debug_stats_t;
+
+/*
+ * One per tablet, shared by both of its HID interfaces. The interfaces
+ * probe separately and find each other through the phys prefix usbhid
+ * gives every interface of a USB device ("usb-0000:00:14.0-1/inputN").
+ * An interface without such a suffix gets a context of its own, named
+ * after its HID device.
+ */
+struct q11k_device
+{
+    struct kref kref;
+    struct list_head node;
+    char phys[64];
+    bool shared;
+    unsigned long quirks;
+
+    struct input_dev __rcu* idev[Q11K_INPUT_COUNT];
+
+    /* pen interface; its reports and prox_timer, which takes the pen out
+       of range when the tablet goes silent, run under pen_lock */
+    struct hid_device* pen_hdev;
+    spinlock_t pen_lock;
+    struct hrtimer prox_timer;
+
+    /* string descriptors, read by strings_work once the pad is registered */
+    struct usb_device* usb_dev;
+    struct work_struct strings_work;
+    bool strings_done;
+    char* strings[Q11K_USB_STRING_COUNT];
+
+    /* probe instrumentation, ktime_get_ns() values, 0 until reached */
+    u64 probe_ns;
+    u64 registered_ns[Q11K_INPUT_COUNT];
+    u64 first_event_ns;
+
+    /* serializes writers of the configuration (state.config) and of
+       the other settings below */
+    struct mutex config_lock;
+    char pressure_desc[Q11K_PRESSURE_DESC_SIZE];
+
+    /* debugfs statistics; last_report_ns is written only by the report
+       path of its interface */
+    q11k_debug_stats_t __percpu* debug_stats;
+    u64 last_report_ns[Q11K_IFACE_COUNT];
+    struct dentry* debugfs_dir;
+
+    /* raw report recording, off while NULL; replaced under config_lock */
+    q11k_record_ring_t __rcu* record;
+    atomic64_t record_seq;
+
+    /* pen sample channel, NULL without the pen_samples parameter. The
+       ring is written by the pen report path under pen_lock; clients
+       (q11k_sample_client_t) are added and removed under config_lock */
+    q11k_sample_ring_t* samples;
+    int sample_id;
+    char sample_name[16];
+    struct miscdevice sample_misc;
+    bool sample_registered;
+    bool samples_gone;
+    wait_queue_head_t sample_wait;
+    struct list_head sample_clients;
+
+    q11k_state_t state;
+};
+
+/* One open file of a pen sample channel */
+typedef struct __tag_q11k_sample_client_t
+{
+    struct list_head node;
+    struct q11k_device* qdev;
+    struct eventfd_ctx __rcu* eventfd;
+    u64 seen;                       /* head the last read() returned */
+    bool hw_open;                   /* holds a hid_hw_open() of the pen */
+} q11k_sample_client_t;
+
+static LIST_HEAD(q11k_devices);
+static DEFINE_MUTEX(q11k_devices_lock);
+static DEFINE_IDA(q11k_sample_ida);
+
+/* debugfs: q11k_device/<tablet phys, or HID device name>/{stats,reset} */
+static struct dentry* q11k_debugfs_root;
+
+/* Default of the per-device stylus_buttons attribute */
+static unsigned int stylus_buttons = Q11K_STYLUS_PEN;
+module_param(stylus_buttons, uint, 0644);
+MODULE_PARM_DESC(stylus_buttons, "Stylus buttons of new tablets: 0 = BTN_STYLUS/BTN_STYLUS2 on the pen, 1 = middle/right mouse buttons");
+
+/* Size of the pen sample ring of new tablets, 0 = no /dev/q11k_penN */
+static unsigned int pen_samples;
+module_param(pen_samples, uint, 0644);
+MODULE_PARM_DESC(pen_samples, "Pen samples kept for /dev/q11k_penN of new tablets, rounded up to a power of two (64..65536); 0 = no sample channel");
+
+static int q11k_probe(struct hid_device *hdev, const struct hid_device_id *id);
+static int q11k_interface_number(struct hid_device *hdev);
+
+static struct q11k_device* q11k_device_get(struct hid_device *hdev);
+static void q11k_device_put(struct q11k_device* qdev);
+
+static int q11k_prepare_pens(struct hid_device *hdev);
+static int q11k_register_pen(struct q11k_device* qdev, struct hid_device *hdev);
+static int q11k_register_relative_pen(struct hid_device *hdev);
+static int q11k_register_keyboard(struct q11k_device* qdev, struct hid_device *hdev);
+static int q11k_register_scroll(struct q11k_device* qdev, struct hid_device *hdev);
+static void __close_keyboard(struct q11k_device* qdev);
+static void q11k_strings_work(struct work_struct *work);
+
+static int q11k_keymap_index(const struct input_keymap_entry *ke, unsigned int *index);
+static int q11k_getkeycode(struct input_dev *dev, struct input_keymap_entry *ke);
+static int q11k_setkeycode(struct input_dev *dev, const struct input_keymap_entry *ke, unsigned int *old_keycode);
+
+static int q11k_raw_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size);
+static int q11k_input_open(struct input_dev *dev);
+static void q11k_input_close(struct input_dev *dev);
+static enum hrtimer_restart q11k_prox_timer(struct hrtimer *timer);
+
+static void q11k_debugfs_add(struct q11k_device* qdev);
+static void q11k_debug_account(struct q11k_device* qdev, enum q11k_iface iface, const u8* data, int size, u64 now);
+static int q11k_debug_stats_show(struct seq_file *m, void *unused);
+static ssize_t q11k_debug_reset_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos);
+static void q11k_record_report(struct q11k_device* qdev, enum q11k_iface iface, const u8* data, int size, u64 now);
+static ssize_t q11k_record_read(struct file *file, char __user *buf, size_t count, loff_t *ppos);
+static int q11k_record_mmap(struct file *file, struct vm_area_struct *vma);
+static ssize_t q11k_record_entries_read(struct file *file, char __user *buf, size_t count, loff_t *ppos);
+static ssize_t q11k_record_entries_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos);
+
+static q11k_sample_ring_t* q11k_sample_ring_alloc(void);
+static void q11k_register_samples(struct q11k_device* qdev, struct hid_device *hdev);
+static void q11k_unregister_samples(struct q11k_device* qdev);
+static int q11k_sample_open(struct inode *inode, struct file *file);
+static int q11k_sample_release(struct inode *inode, struct file *file);
+static ssize_t q11k_sample_read(struct file *file, char __user *buf, size_t count, loff_t *ppos);
+static __poll_t q11k_sample_poll(struct file *file, poll_table *wait);
+static int q11k_sample_mmap(struct file *file, struct vm_area_struct *vma);
+static long q11k_sample_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+
+static ssize_t dropped_reports_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t probe_timing_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t pressure_curve_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t pressure_curve_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static int q11k_parse_pressure_curve(const char* buf, q11k_pressure_lut_t* lut, char* desc);
+static ssize_t q11k_string_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t q11k_param_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t q11k_param_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static int q11k_area_update(struct q11k_device* qdev, q11k_config_t* cfg);
+static void q11k_area_published(struct q11k_device* qdev, const q11k_config_t* cfg);
+static void q11k_update_abs_ranges(struct q11k_device* qdev, const q11k_config_t* cfg, bool widen);
+static q11k_config_t* q11k_config_locked(struct q11k_device* qdev);
+static q11k_config_t* q11k_config_dup(struct q11k_device* qdev);
+static void q11k_config_publish(struct q11k_device* qdev, q11k_config_t* cfg);
+
+/*
+ * A u32 tunable inside q11k_config_t, shared by both interfaces of the
+ * tablet. A write builds a new config with the value set and @update
+ * run on it to rebuild what is derived from it; if @update fails the
+ * live config is left alone. Once the new config is live, @published
+ * passes it on to what lives outside the config.
+ */
+struct q11k_param_attribute
+{
+    struct device_attribute attr;
+    size_t offset;
+    u32 min;
+    u32 max;
+    int (*update)(struct q11k_device* qdev, q11k_config_t* cfg);
+    void (*published)(struct q11k_device* qdev, const q11k_config_t* cfg);
+};
+
+#define Q11K_PARAM_ATTR_UPDATE(_group, _name, _field, _min, _max, _update, _published) \
+    static struct q11k_param_attribute q11k_##_group##_attr_##_name = {         \
+        .attr      = __ATTR(_name, 0644, q11k_param_show, q11k_param_store),    \
+        .offset    = offsetof(q11k_config_t, _field),                           \
+        .min       = (_min),                                                    \
+        .max       = (_max),                                                    \
+        .update    = (_update),                                                 \
+        .published = (_published),                                              \
+    }
+
+#define Q11K_PARAM_ATTR(_group, _name, _field, _min, _max)                     \
+    Q11K_PARAM_ATTR_UPDATE(_group, _name, _field, _min, _max, NULL, NULL)
+
+static void q11k_sink_report_key(void* ctx, enum q11k_input idev, unsigned int code, int value);
+static void q11k_sink_report_abs(void* ctx, enum q11k_input idev, unsigned int code, int value);
+static void q11k_sink_report_msc(void* ctx, enum q11k_input idev, unsigned int code, int value);
+static void q11k_sink_report_rel(void* ctx, enum q11k_input idev, unsigned int code, int value);
+static void q11k_sink_sync_dev(void* ctx, enum q11k_input idev, u64 time_ns);
+static void q11k_sink_pen_frame_dev(void* ctx, const q11k_pen_frame_t* frame, u64 time_ns);
+
+/* One of q11k_usb_strings[] */
+struct q11k_string_attribute
+{
+    struct device_attribute attr;
+    int slot;
+};
+
+#define Q11K_STRING_ATTR(_slot, _name)                                          \
+    static struct q11k_string_attribute q11k_string_attr_##_slot = {            \
+        .attr = __ATTR(_name, 0444, q11k_string_show, NULL),                    \
+        .slot = (_slot),                                                        \
+    }
+
+static DEVICE_ATTR_RO(dropped_reports);
+static DEVICE_ATTR_RO(probe_timing);
+static DEVICE_ATTR_RW(pressure_curve);
+
+Q11K_PARAM_ATTR(main, stylus_buttons, stylus_mode, 0, Q11K_STYLUS_MODES - 1);
+Q11K_PARAM_ATTR(main, proximity_timeout_ms, prox_timeout_ms, 0, Q11K_PROX_MAX_TIMEOUT_MS);
+
+static struct attribute *q11k_attrs[] = {
+    &dev_attr_dropped_reports.attr,
+    &dev_attr_probe_timing.attr,
+    &dev_attr_pressure_curve.attr,
+    &q11k_main_attr_stylus_buttons.attr.attr,
+    &q11k_main_attr_proximity_timeout_ms.attr.attr,
+    NULL
+};
+
+static const struct attribute_group q11k_attr_group = {
+    .attrs = q11k_attrs,
+};
+
+Q11K_PARAM_ATTR(filter, enable,     filter.enabled,        0, 1);
+Q11K_PARAM_ATTR(filter, rate,       filter.rate_hz,        1, Q11K_FILTER_MAX_RATE);
+Q11K_PARAM_ATTR(filter, min_cutoff, filter.min_cutoff_mhz, 1, Q11K_FILTER_MAX_CUTOFF);
+Q11K_PARAM_ATTR(filter, beta,       filter.beta,           0, Q11K_FILTER_MAX_BETA);
+Q11K_PARAM_ATTR(filter, d_cutoff,   filter.d_cutoff_mhz,   1, Q11K_FILTER_MAX_CUTOFF);
+Q11K_PARAM_ATTR(filter, predict,    filter.predict_us,     0, Q11K_FILTER_MAX_PREDICT);
+
+Q11K_PARAM_ATTR(deadband, enable,         deadband.enabled,        0, 1);
+Q11K_PARAM_ATTR(deadband, hover_radius,   deadband.hover_radius,   0, Q11K_DEADBAND_MAX_RADIUS);
+Q11K_PARAM_ATTR(deadband, contact_radius, deadband.contact_radius, 0, Q11K_DEADBAND_MAX_RADIUS);
+Q11K_PARAM_ATTR(deadband, pressure,       deadband.pressure,       0, Q11K_DEADBAND_MAX_PRESSURE);
+Q11K_PARAM_ATTR(deadband, settle,         deadband.settle,         0, Q11K_DEADBAND_MAX_SETTLE);
+
+Q11K_PARAM_ATTR(relative, gain,     relative.gain,     1, REL_PEN_MAX_GAIN);
+Q11K_PARAM_ATTR(relative, accel,    relative.accel,    0, REL_PEN_MAX_GAIN);
+Q11K_PARAM_ATTR(relative, max_gain, relative.max_gain, 1, REL_PEN_MAX_GAIN);
+Q11K_PARAM_ATTR(relative, gap_ms,   relative.gap_ms,   1, REL_PEN_MAX_GAP_MS);
+
+static struct attribute *q11k_filter_attrs[] = {
+    &q11k_filter_attr_enable.attr.attr,
+    &q11k_filter_attr_rate.attr.attr,
+    &q11k_filter_attr_min_cutoff.attr.attr,
+    &q11k_filter_attr_beta.attr.attr,
+    &q11k_filter_attr_d_cutoff.attr.attr,
+    &q11k_filter_attr_predict.attr.attr,
+    NULL
+};
+
+/* filter/: rate in Hz, cutoffs in mHz, beta in uHz per count/s, predict in us */
+static const struct attribute_group q11k_filter_attr_group = {
+    .name  = "filter",
+    .attrs = q11k_filter_attrs,
+};
+
+static struct attribute *q11k_deadband_attrs[] = {
+    &q11k_deadband_attr_enable.attr.attr,
+    &q11k_deadband_attr_hover_radius.attr.attr,
+    &q11k_deadband_attr_contact_radius.attr.attr,
+    &q11k_deadband_attr_pressure.attr.attr,
+    &q11k_deadband_attr_settle.attr.attr,
+    NULL
+};
+
+/* deadband/: radii in tablet counts, pressure in raw units, settle in reports */
+static const struct attribute_group q11k_deadband_attr_group = {
+    .name  = "deadband",
+    .attrs = q11k_deadband_attrs,
+};
+
+static struct attribute *q11k_relative_attrs[] = {
+    &q11k_relative_attr_gain.attr.attr,
+    &q11k_relative_attr_accel.attr.attr,
+    &q11k_relative_attr_max_gain.attr.attr,
+    &q11k_relative_attr_gap_ms.attr.attr,
+    NULL
+};
+
+/* relative/: gains in permille, accel in permille per count/ms */
+static const struct attribute_group q11k_relative_attr_group = {
+    .name  = "relative",
+    .attrs = q11k_relative_attrs,
+};
+
+Q11K_PARAM_ATTR_UPDATE(area, x,           area.x,           0, MAX_ABS_X - 1, q11k_area_update, q11k_area_published);
+Q11K_PARAM_ATTR_UPDATE(area, y,           area.y,           0, MAX_ABS_Y - 1, q11k_area_update, q11k_area_published);
+Q11K_PARAM_ATTR_UPDATE(area, width,       area.width,       0, MAX_ABS_X,     q11k_area_update, q11k_area_published);
+Q11K_PARAM_ATTR_UPDATE(area, height,      area.height,      0, MAX_ABS_Y,     q11k_area_update, q11k_area_published);
+Q11K_PARAM_ATTR_UPDATE(area, rotation,    area.rotation,    0, 270,           q11k_area_update, q11k_area_published);
+Q11K_PARAM_ATTR_UPDATE(area, left_handed, area.left_handed, 0, 1,             q11k_area_update, q11k_area_published);
+
+static struct attribute *q11k_area_attrs[] = {
+    &q11k_area_attr_x.attr.attr,
+    &q11k_area_attr_y.attr.attr,
+    &q11k_area_attr_width.attr.attr,
+    &q11k_area_attr_height.attr.attr,
+    &q11k_area_attr_rotation.attr.attr,
+    &q11k_area_attr_left_handed.attr.attr,
+    NULL
+};
+
+Q11K_PARAM_ATTR(scroll, enable,       scroll.enabled,      0, 1);
+Q11K_PARAM_ATTR(scroll, three_finger, scroll.three_finger, 0, 1);
+Q11K_PARAM_ATTR(scroll, step,         scroll.step,         1, Q11K_SCROLL_MAX_STEP);
+Q11K_PARAM_ATTR(scroll, accel,        scroll.accel,        0, Q11K_SCROLL_MAX_ACCEL);
+Q11K_PARAM_ATTR(scroll, max_step,     scroll.max_step,     1, Q11K_SCROLL_MAX_STEP);
+
+static struct attribute *q11k_scroll_attrs[] = {
+    &q11k_scroll_attr_enable.attr.attr,
+    &q11k_scroll_attr_three_finger.attr.attr,
+    &q11k_scroll_attr_step.attr.attr,
+    &q11k_scroll_attr_accel.attr.attr,
+    &q11k_scroll_attr_max_step.attr.attr,
+    NULL
+};
+
+/*
+ * scroll/: enable takes over the two finger swipes (0x12-0x15) and, with
+ * three_finger, the three finger ones (0x22-0x25) and their keys; steps
+ * in hi-res wheel units (120 per detent), accel in permille per notch/s
+ */
+static const struct attribute_group q11k_scroll_attr_group = {
+    .name  = "scroll",
+    .attrs = q11k_scroll_attrs,
+};
+
+/* area/: active area in tablet counts (size 0 = to the edge), rotation in degrees */
+static const struct attribute_group q11k_area_attr_group = {
+    .name  = "area",
+    .attrs = q11k_area_attrs,
+};
+
+Q11K_STRING_ATTR(0, 0x02);
+Q11K_STRING_ATTR(1, 0xc9);
+Q11K_STRING_ATTR(2, 0xc8);
+Q11K_STRING_ATTR(3, 0xca);
+
+static struct attribute *q11k_string_attrs[] = {
+    &q11k_string_attr_0.attr.attr,
+    &q11k_string_attr_1.attr.attr,
+    &q11k_string_attr_2.attr.attr,
+    &q11k_string_attr_3.attr.attr,
+    NULL
+};
+
+/* strings/: cached USB string descriptors, by descriptor index */
+static const struct attribute_group q11k_string_attr_group = {
+    .name  = "strings",
+    .attrs = q11k_string_attrs,
+};
+
+static const struct attribute_group *q11k_attr_groups[] = {
+    &q11k_attr_group,
+    &q11k_filter_attr_group,
+    &q11k_deadband_attr_group,
+    &q11k_relative_attr_group,
+    &q11k_area_attr_group,
+    &q11k_scroll_attr_group,
+    &q11k_string_attr_group,
+    NULL
+};
+
+static const struct q11k_sink_ops q11k_input_sink = {
+    .report_key = q11k_sink_report_key,
+    .report_abs = q11k_sink_report_abs,
+    .report_msc = q11k_sink_report_msc,
+    .report_rel = q11k_sink_report_rel,
+    .sync       = q11k_sink_sync_dev,
+    .pen_frame  = q11k_sink_pen_frame_dev,
+};
+
+static int q11k_probe(struct hid_device *hdev, const struct hid_device_id *id)
+{
+    int rc = 0;
+    struct usb_device *usb_dev = NULL;
+    struct q11k_device* qdev;
+    int if_number = q11k_interface_number(hdev);
+
+    if (hid_is_usb(hdev))
+    {
+        usb_dev = interface_to_usbdev(to_usb_interface(hdev->dev.parent));
+    }
+
+    hdev->quirks |= HID_QUIRK_MULTI_INPUT;
+	#ifdef HID_QUIRK_NO_EMPTY_INPUT
+            hdev->quirks |= HID_QUIRK_NO_EMPTY_INPUT;
+        #endif
+
+    if (id->product != USB_DEVICE_ID_HUION_TABLET)
+    {
+        DPRINT("q11k hid strange error");
+        return -ENODEV;
+    }
+
+    DPRINT("q11k device detected if=%d", if_number);
+
+    qdev = q11k_device_get(hdev);
+    if (qdev == NULL)
+    {
+        return -ENOMEM;
+    }
+    qdev->quirks = id->driver_data;
+
+    hid_set_drvdata(hdev, qdev);
+    if (if_number == 1)
+    {
+        qdev->pen_hdev = hdev;
+    }
+
+    rc = hid_parse(hdev);
+    if (rc)
+    {
+        hid_err(hdev, "parse failed\n");
+        goto err_put;
+    }
+
+    rc = hid_hw_start(hdev, HID_CONNECT_HIDRAW);
+    if (rc)
+    {
+        hid_err(hdev, "hw start failed\n");
+        goto err_put;
+    }
+
+    /* no hid_hw_open() here, I/O runs while an input device is open */
+    rc = sysfs_create_groups(&hdev->dev.kobj, q11k_attr_groups);
+    if (rc)
+    {
+        hid_err(hdev, "cannot create sysfs attributes\n");
+        goto err_stop;
+    }
+
+    if (if_number == 1)
+    {
+        rc = q11k_register_pen(qdev, hdev);
+        if (rc == 0)
+        {
+            q11k_register_samples(qdev, hdev);
+        }
+    }
+    else if (if_number == 0)
+    {
+        rc = q11k_register_keyboard(qdev, hdev);
+        if (rc == 0)
+        {
+            rc = q11k_register_scroll(qdev, hdev);
+            if (rc)
+            {
+                __close_keyboard(qdev);
+            }
+        }
+    }
+
+    if (rc)
+    {
+        goto err_sysfs;
+    }
+
+    if (if_number == 0 && usb_dev != NULL && !qdev->strings_done)
+    {
+        qdev->usb_dev = usb_dev;
+        schedule_work(&qdev->strings_work);
+    }
+
+    DPRINT("q11k device ok");
+    return 0;
+
+err_sysfs:
+    sysfs_remove_groups(&hdev->dev.kobj, q11k_attr_groups);
+err_stop:
+    hid_hw_stop(hdev);
+err_put:
+    if (qdev->pen_hdev == hdev)
+    {
+        qdev->pen_hdev = NULL;
+    }
+    hid_set_drvdata(hdev, NULL);
+    q11k_device_put(qdev);
+    return rc;
+}
+
+static struct q11k_device* q11k_device_get(struct hid_device *hdev)
+{
+    struct q11k_device* qdev;
+    const char* suffix = strrchr(hdev->phys, '/');
+    bool shared = (suffix != NULL && suffix != hdev->phys);
+    const char* name = shared ? hdev->phys : dev_name(&hdev->dev);
+    size_t len = shared ? (size_t)(suffix - hdev->phys) : strlen(name);
+
+    len = min(len, sizeof(qdev->phys) - 1);
+
+    mutex_lock(&q11k_devices_lock);
+
+    list_for_each_entry(qdev, &q11k_devices, node)
+    {
+        if (shared && qdev->shared
+            && (strncmp(qdev->phys, hdev->phys, len) == 0) && (qdev->phys[len] == '\0'))
+        {
+            kref_get(&qdev->kref);
+            goto out;
+        }
+    }
+
+    qdev = kzalloc(sizeof(*qdev), GFP_KERNEL);
+    if (qdev == NULL)
+    {
+        goto out;
+    }
+
+    qdev->debug_stats = alloc_percpu(q11k_debug_stats_t);
+    if (qdev->debug_stats == NULL)
+    {
+        kfree(qdev);
+        qdev = NULL;
+        goto out;
+    }
+
+    if (pen_samples != 0)
+    {
+        qdev->samples = q11k_sample_ring_alloc();
+        if (qdev->samples == NULL)
+        {
+            free_percpu(qdev->debug_stats);
+            kfree(qdev);
+            qdev = NULL;
+            goto out;
+        }
+    }
+
+    kref_init(&qdev->kref);
+    memcpy(qdev->phys, name, len);
+    qdev->shared = shared;
+    INIT_WORK(&qdev->strings_work, q11k_strings_work);
+    mutex_init(&qdev->config_lock);
+    spin_lock_init(&qdev->pen_lock);
+    init_waitqueue_head(&qdev->sample_wait);
+    INIT_LIST_HEAD(&qdev->sample_clients);
+    hrtimer_setup(&qdev->prox_timer, q11k_prox_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    strscpy(qdev->pressure_desc, "linear", sizeof(qdev->pressure_desc));
+    qdev->probe_ns = ktime_get_ns();
+    q11k_core_init(&qdev->state, &q11k_input_sink, qdev);
+    if (stylus_buttons < Q11K_STYLUS_MODES)
+    {
+        qdev->state.default_config.stylus_mode = stylus_buttons;
+    }
+    list_add(&qdev->node, &q11k_devices);
+    q11k_debugfs_add(qdev);
+
+out:
+    mutex_unlock(&q11k_devices_lock);
+    return qdev;
+}
+
+static void q11k_device_release(struct kref *kref)
+{
+    struct q11k_device* qdev = container_of(kref, struct q11k_device, kref);
+    q11k_config_t* cfg;
+    int i;
+
+    list_del(&qdev->node);
+    debugfs_remove_recursive(qdev->debugfs_dir);
+    hrtimer_cancel(&qdev->prox_timer);
+    for (i = 0; i < Q11K_USB_STRING_COUNT; i++)
+    {
+        kfree(qdev->strings[i]);
+    }
+    cfg = rcu_dereference_protected(qdev->state.config, true);
+    kfree(cfg->pressure);
+    if (cfg != &qdev->state.default_config)
+    {
+        kfree(cfg);
+    }
+    free_percpu(qdev->debug_stats);
+    vfree(rcu_dereference_protected(qdev->record, true));
+    vfree(qdev->samples);
+    kfree(qdev);
+}
+
+static void q11k_device_put(struct q11k_device* qdev)
+{
+    mutex_lock(&q11k_devices_lock);
+    kref_put(&qdev->kref, q11k_device_release);
+    mutex_unlock(&q11k_devices_lock);
+}
+
+/*
+ * The tablet exposes the pen and the pad keys on separate interfaces. On
+ * USB they are told apart by bInterfaceNumber; virtual transports (uhid,
+ * see tools/q11k_emu.c) carry the number in the usbhid style phys suffix
+ * "/inputN".
+ */
+static int q11k_interface_number(struct hid_device *hdev)
+{
+    const char* suffix;
+    int if_number;
+
+    if (hid_is_usb(hdev))
+    {
+        struct usb_interface *intf = to_usb_interface(hdev->dev.parent);
+        return intf->cur_altsetting->desc.bInterfaceNumber;
+    }
+
+    suffix = strrchr(hdev->phys, '/');
+    if ((suffix == NULL) || (sscanf(suffix, "/input%d", &if_number) != 1))
+    {
+        return -1;
+    }
+
+    return if_number;
+}
+
+static int q11k_register_pen(struct q11k_device* qdev, struct hid_device *hdev)
+{
+    int rc;
+    struct input_dev* idev_pen;
+
+    idev_pen = input_allocate_device();
+    if (idev_pen == NULL)
+    {
+        hid_err(hdev, "failed to allocate input device for pen\n");
+        return -ENOMEM;
+    }
+
+    input_set_drvdata(idev_pen, hdev);
+
+    idev_pen->name       = "Huion Q11K Tablet";
+    idev_pen->id.bustype = BUS_USB;
+    idev_pen->id.vendor  = 0x56a;
+    idev_pen->id.version = 0;
+    idev_pen->dev.parent = &hdev->dev;
+    idev_pen->open       = q11k_input_open;
+    idev_pen->close      = q11k_input_close;
+
+    set_bit(EV_REP, idev_pen->evbit);
+
+    input_set_capability(idev_pen, EV_ABS, ABS_X);
+	input_set_capability(idev_pen, EV_ABS, ABS_Y);
+    input_set_capability(idev_pen, EV_ABS, ABS_PRESSURE);
+    input_set_capability(idev_pen, EV_KEY, BTN_TOOL_PEN);
+    input_set_capability(idev_pen, EV_KEY, BTN_TOUCH);
+    input_set_capability(idev_pen, EV_KEY, BTN_STYLUS);
+    input_set_capability(idev_pen, EV_KEY, BTN_STYLUS2);
+    input_set_capability(idev_pen, EV_MSC, MSC_TIMESTAMP);
+
+    /* the area/ settings may change these later, see q11k_update_abs_ranges();
+       no fuzz, the input core's averaging would lag the pen behind the
+       core's deadband (deadband/) */
+    input_set_abs_params(idev_pen, ABS_X, 0, MAX_ABS_X, 0, 0);  // 55662
+    input_set_abs_params(idev_pen, ABS_Y, 0, MAX_ABS_Y, 0, 0);  // 34789
+    input_set_abs_params(idev_pen, ABS_PRESSURE, 0, MAX_ABS_PRESSURE, 0, 0);
+    input_set_events_per_packet(idev_pen, DIV_ROUND_UP(Q11K_PEN_FRAME_EVENTS * Q11K_PEN_BUFFERED_FRAMES,
+                                                       Q11K_EVDEV_BUF_PACKETS));
+
+    rc = input_register_device(idev_pen);
+    if (rc)
+    {
+        hid_err(hdev, "error registering the input device for pen\n");
+        input_free_device(idev_pen);
+        return rc;
+    }
+
+    rcu_assign_pointer(qdev->idev[Q11K_INPUT_PEN], idev_pen);
+    qdev->registered_ns[Q11K_INPUT_PEN] = ktime_get_ns();
+
+    mutex_lock(&qdev->config_lock);
+    q11k_update_abs_ranges(qdev, q11k_config_locked(qdev), false);
+    mutex_unlock(&qdev->config_lock);
+    return 0;
+}
+
+static int q11k_register_keyboard(struct q11k_device* qdev, struct hid_device *hdev)
+{
+    int rc = 0;
+    int i = 0;
+    struct input_dev* idev_keyboard;
+
+    idev_keyboard = input_allocate_device();
+    if (idev_keyboard == NULL)
+    {
+        hid_err(hdev, "failed to allocate input device [kb]\n");
+        return -ENOMEM;
+    }
+
+    idev_keyboard->name                 = "Huion Q11K Keyboard";
+    idev_keyboard->id.bustype           = BUS_USB;
+    idev_keyboard->id.vendor            = 0x04b4;
+    idev_keyboard->id.version           = 0;
+    idev_keyboard->dev.parent           = &hdev->dev;
+    idev_keyboard->open                 = q11k_input_open;
+    idev_keyboard->close                = q11k_input_close;
+    idev_keyboard->keycode              = qdev->state.pad.keymap;
+    idev_keyboard->keycodemax           = Q11K_KEYMAP_SIZE;
+    idev_keyboard->keycodesize          = sizeof(qdev->state.pad.keymap[0]);
+    idev_keyboard->getkeycode           = q11k_getkeycode;
+    idev_keyboard->setkeycode           = q11k_setkeycode;
+    input_set_drvdata(idev_keyboard, qdev);
+
+    input_set_capability(idev_keyboard, EV_MSC, MSC_SCAN);
+
+    for (i=0; i<Q11K_KEYMAP_SIZE; i++)
+    {
+        if (qdev->state.pad.keymap[i] != KEY_RESERVED)
+        {
+            input_set_capability(idev_keyboard, EV_KEY, qdev->state.pad.keymap[i]);
+        }
+    }
+
+    for (i=0; i<Q11K_PAD_MODIFIER_COUNT; i++)
+    {
+        input_set_capability(idev_keyboard, EV_KEY, q11k_pad_modifiers[i]);
+    }
+
+    /* stylus buttons, when stylus_buttons routes them here */
+    input_set_capability(idev_keyboard, EV_KEY, BTN_MIDDLE);
+    input_set_capability(idev_keyboard, EV_KEY, BTN_RIGHT);
+    input_set_events_per_packet(idev_keyboard, Q11K_KEYBOARD_FRAME_EVENTS);
+
+    rc = input_register_device(idev_keyboard);
+    if (rc)
+    {
+        hid_err(hdev, "error registering the input device [kb]\n");
+        input_free_device(idev_keyboard);
+        return rc;
+    }
+
+    rcu_assign_pointer(qdev->idev[Q11K_INPUT_KEYBOARD], idev_keyboard);
+    qdev->registered_ns[Q11K_INPUT_KEYBOARD] = ktime_get_ns();
+    return 0;
+}
+
+/*
+ * Output of the strip scroll mode. The pointer axes and button are never
+ * reported; udev's input_id tags a node as ID_INPUT_MOUSE by its mouse
+ * button and relative X/Y, not by its wheels, and libinput ignores a
+ * node without that tag.
+ */
+static int q11k_register_scroll(struct q11k_device* qdev, struct hid_device *hdev)
+{
+    int rc = 0;
+    struct input_dev* idev_scroll;
+
+    idev_scroll = input_allocate_device();
+    if (idev_scroll == NULL)
+    {
+        hid_err(hdev, "failed to allocate input device [scroll]\n");
+        return -ENOMEM;
+    }
+
+    idev_scroll->name           = "Huion Q11K Scroll";
+    idev_scroll->id.bustype     = BUS_USB;
+    idev_scroll->id.vendor      = 0x04b4;
+    idev_scroll->id.version     = 0;
+    idev_scroll->dev.parent     = &hdev->dev;
+    idev_scroll->open           = q11k_input_open;
+    idev_scroll->close          = q11k_input_close;
+
+    input_set_capability(idev_scroll, EV_REL, REL_X);
+    input_set_capability(idev_scroll, EV_REL, REL_Y);
+    input_set_capability(idev_scroll, EV_KEY, BTN_LEFT);
+    input_set_capability(idev_scroll, EV_REL, REL_WHEEL);
+    input_set_capability(idev_scroll, EV_REL, REL_HWHEEL);
+    input_set_capability(idev_scroll, EV_REL, REL_WHEEL_HI_RES);
+    input_set_capability(idev_scroll, EV_REL, REL_HWHEEL_HI_RES);
+    input_set_events_per_packet(idev_scroll, Q11K_SCROLL_FRAME_EVENTS);
+
+    rc = input_register_device(idev_scroll);
+    if (rc)
+    {
+        hid_err(hdev, "error registering the input device [scroll]\n");
+        input_free_device(idev_scroll);
+        return rc;
+    }
+
+    rcu_assign_pointer(qdev->idev[Q11K_INPUT_SCROLL], idev_scroll);
+    qdev->registered_ns[Q11K_INPUT_SCROLL] = ktime_get_ns();
+    return 0;
+}
+
+static void q11k_strings_work(struct work_struct *work)
+{
+    struct q11k_device* qdev = container_of(work, struct q11k_device, strings_work);
+    char* buf = kmalloc(Q11K_USB_STRING_SIZE, GFP_KERNEL);
+    int i, rc;
+
+    if (buf == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < Q11K_USB_STRING_COUNT; i++)
+    {
+        rc = usb_string(qdev->usb_dev, q11k_usb_strings[i].index, buf, Q11K_USB_STRING_SIZE);
+        if (rc > 0)
+        {
+            DPRINT("String(0x%02x) = %s", q11k_usb_strings[i].index, buf);
+            /* a rebind after a cancelled read may find some already cached */
+            if (qdev->strings[i] == NULL)
+            {
+                qdev->strings[i] = kstrndup(buf, rc, GFP_KERNEL);
+            }
+        }
+    }
+
+    kfree(buf);
+    smp_store_release(&qdev->strings_done, true);
+}
+
+/*
+ * Keymap of the pad. Scancodes are Q11K_SCAN_KEY() / Q11K_SCAN_GESTURE()
+ * values and index the per-device table the core maps from directly.
+ */
+static int q11k_keymap_index(const struct input_keymap_entry *ke, unsigned int *index)
+{
+    if (ke->flags & INPUT_KEYMAP_BY_INDEX)
+    {
+        *index = ke->index;
+    }
+    else if (input_scancode_to_scalar(ke, index))
+    {
+        return -EINVAL;
+    }
+
+    return (*index < Q11K_KEYMAP_SIZE) ? 0 : -EINVAL;
+}
+
+static int q11k_getkeycode(struct input_dev *dev, struct input_keymap_entry *ke)
+{
+    struct q11k_device* qdev = input_get_drvdata(dev);
+    unsigned int index;
+    int rc = q11k_keymap_index(ke, &index);
+
+    if (rc)
+    {
+        return rc;
+    }
+
+    ke->keycode = READ_ONCE(qdev->state.pad.keymap[index]);
+    ke->index = index;
+    ke->len = sizeof(index);
+    memcpy(ke->scancode, &index, sizeof(index));
+    return 0;
+}
+
+/*
+ * The old keycode keeps its capability bit: the same code may still be
+ * reported by another scancode, a modifier or a stylus button.
+ */
+static int q11k_setkeycode(struct input_dev *dev, const struct input_keymap_entry *ke, unsigned int *old_keycode)
+{
+    struct q11k_device* qdev = input_get_drvdata(dev);
+    unsigned int index;
+    int rc = q11k_keymap_index(ke, &index);
+
+    if (rc)
+    {
+        return rc;
+    }
+
+    *old_keycode = qdev->state.pad.keymap[index];
+    WRITE_ONCE(qdev->state.pad.keymap[index], ke->keycode);
+    __set_bit(ke->keycode, dev->keybit);
+    return 0;
+}
+
+/*
+ * The interrupt endpoint of an interface is only polled while one of its
+ * input devices (or hidraw) is open. hid_hw_open() counts the users per
+ * interface, so the last close stops the I/O.
+ */
+static int q11k_input_open(struct input_dev *dev)
+{
+    struct hid_device* hdev = to_hid_device(dev->dev.parent);
+
+    hid_dbg(hdev, "%s opened\n", dev->name);
+    return hid_hw_open(hdev);
+}
+
+static void q11k_input_close(struct input_dev *dev)
+{
+    struct hid_device* hdev = to_hid_device(dev->dev.parent);
+
+    hid_hw_close(hdev);
+    hid_dbg(hdev, "%s closed\n", dev->name);
+}
+
+static int q11k_raw_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size)
+{
+    /* stamp before anything else, the frames carry this time to evdev */
+    u64 now = ktime_get_ns();
+    struct q11k_device* qdev = hid_get_drvdata(hdev);
+    enum q11k_iface iface = (hdev == qdev->pen_hdev) ? Q11K_IFACE_PEN : Q11K_IFACE_PAD;
+
+    if (unlikely(READ_ONCE(qdev->first_event_ns) == 0)
+        && cmpxchg64(&qdev->first_event_ns, 0, now) == 0)
+    {
+        hid_info(hdev, "first report %llu us after probe\n", div_u64(now - qdev->probe_ns, 1000));
+    }
+
+    rcu_read_lock();
+    q11k_record_report(qdev, iface, data, size, now);
+    if (iface == Q11K_IFACE_PEN)
+    {
+        unsigned long flags;
+        u64 deadline;
+
+        spin_lock_irqsave(&qdev->pen_lock, flags);
+        q11k_core_iface_event(&qdev->state, iface, data, size, now);
+
+        /* a queued timer re-reads the deadline when it fires */
+        deadline = q11k_core_pen_deadline(&qdev->state);
+        if (deadline != 0 && !hrtimer_is_queued(&qdev->prox_timer))
+        {
+            hrtimer_start(&qdev->prox_timer, ns_to_ktime(deadline), HRTIMER_MODE_ABS);
+        }
+        spin_unlock_irqrestore(&qdev->pen_lock, flags);
+    }
+    else
+    {
+        q11k_core_iface_event(&qdev->state, iface, data, size, now);
+    }
+    q11k_debug_account(qdev, iface, data, size, now);
+    rcu_read_unlock();
+
+    return 0;
+}
+
+/* 0 for 0 ns, else i for a value in [2^(i-1), 2^i) */
+static inline int q11k_hist_bucket(u64 ns)
+{
+    return min(fls64(ns), Q11K_HIST_BUCKETS - 1);
+}
+
+/* Called at the end of q11k_raw_event(), @now is its arrival stamp */
+static void q11k_debug_account(struct q11k_device* qdev, enum q11k_iface iface, const u8* data, int size, u64 now)
+{
+    q11k_debug_stats_t* stats = get_cpu_ptr(qdev->debug_stats);
+    u64 last = qdev->last_report_ns[iface];
+
+    if (size >= Q11K_REPORT_HEADER_SIZE)
+    {
+        stats->reports[data[1]]++;
+    }
+    if (last != 0)
+    {
+        stats->interval[iface][q11k_hist_bucket(now - last)]++;
+    }
+    stats->process[q11k_hist_bucket(ktime_get_ns() - now)]++;
+    put_cpu_ptr(qdev->debug_stats);
+
+    qdev->last_report_ns[iface] = now;
+}
+
+/*
+ * Store one report in the recording ring. Both interfaces may record at
+ * once; each owns the slot of the sequence number it reserved.
+ */
+static void q11k_record_report(struct q11k_device* qdev, enum q11k_iface iface, const u8* data, int size, u64 now)
+{
+    q11k_record_ring_t* ring = rcu_dereference(qdev->record);
+    q11k_record_t* e;
+    u64 seq, head;
+
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    seq = atomic64_inc_return(&qdev->record_seq);
+    e = &ring->e[(seq - 1) & (ring->entries - 1)];
+
+    WRITE_ONCE(e->seq, 0);
+    smp_wmb();
+    e->t_ns = now;
+    memset(e->report, 0, sizeof(e->report));
+    memcpy(e->report, data, min(size, Q11K_REPORT_SIZE));
+    e->size = min(size, 255);
+    e->iface = iface;
+    smp_store_release(&e->seq, seq);
+
+    head = READ_ONCE(ring->head);
+    while (head < seq)
+    {
+        u64 prev = cmpxchg64(&ring->head, head, seq);
+
+        if (prev == head)
+        {
+            break;
+        }
+        head = prev;
+    }
+}
+
+/*
+ * Armed once per proximity and pushed out to the last report's deadline
+ * when it fires, so the report path never reprograms it.
+ */
+static enum hrtimer_restart q11k_prox_timer(struct hrtimer *timer)
+{
+    struct q11k_device* qdev = container_of(timer, struct q11k_device, prox_timer);
+    enum hrtimer_restart ret = HRTIMER_NORESTART;
+    u64 now = ktime_get_ns();
+    unsigned long flags;
+    u64 deadline;
+
+    spin_lock_irqsave(&qdev->pen_lock, flags);
+    rcu_read_lock();
+    deadline = q11k_core_pen_deadline(&qdev->state);
+    if (deadline > now)
+    {
+        hrtimer_set_expires(timer, ns_to_ktime(deadline));
+        ret = HRTIMER_RESTART;
+    }
+    else if (deadline != 0)
+    {
+        q11k_core_pen_release(&qdev->state, now);
+    }
+    rcu_read_unlock();
+    spin_unlock_irqrestore(&qdev->pen_lock, flags);
+
+    return ret;
+}
+
+/*
+ * Microseconds from the start of the tablet's first probe to each input
+ * device registration and to the first report, "-" if not reached yet.
+ */
+static ssize_t probe_timing_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    static const char* const names[] = { "pen_registered", "keyboard_registered", "first_report" };
+    struct q11k_device* qdev = hid_get_drvdata(to_hid_device(dev));
+    u64 t[] = {
+        READ_ONCE(qdev->registered_ns[Q11K_INPUT_PEN]),
+        READ_ONCE(qdev->registered_ns[Q11K_INPUT_KEYBOARD]),
+        READ_ONCE(qdev->first_event_ns),
+    };
+    ssize_t len = 0;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(t); i++)
+    {
+        if (t[i] == 0)
+        {
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%s -\n", names[i]);
+        }
+        else
+        {
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%s %llu\n", names[i],
+                             div_u64(t[i] - qdev->probe_ns, 1000));
+        }
+    }
+
+    return len;
+}
+
+/* Waits for a pending read of the strings rather than racing it */
+static ssize_t q11k_string_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct q11k_device* qdev = hid_get_drvdata(to_hid_device(dev));
+    struct q11k_string_attribute* sattr = container_of(attr, struct q11k_string_attribute, attr);
+
+    flush_work(&qdev->strings_work);
+    if (!smp_load_acquire(&qdev->strings_done) || qdev->strings[sattr->slot] == NULL)
+    {
+        return -ENODATA;
+    }
+
+    return scnprintf(buf, PAGE_SIZE, "%s\n", qdev->strings[sattr->slot]);
+}
+
+/*
+ * Reports the core dropped: "truncated" and "misrouted" (a report type
+ * that belongs to the other interface) totals, then one "foreign id
+ * count" line per report ID other than Q11K_REPORT_ID and one "type count"
+ * line per report type byte without a handler.
+ */
+static ssize_t dropped_reports_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct q11k_device* qdev = hid_get_drvdata(to_hid_device(dev));
+    const q11k_report_stats_t* stats = &qdev->state.stats;
+    ssize_t len;
+    int i;
+
+    len = scnprintf(buf, PAGE_SIZE, "truncated %u\nmisrouted %u\n",
+                    atomic_read(&stats->truncated), atomic_read(&stats->misrouted));
+
+    for (i = 0; i < Q11K_REPORT_IDS; i++)
+    {
+        u32 count = atomic_read(&stats->foreign[i]);
+
+        if (count != 0)
+        {
+            len += scnprintf(buf + len, PAGE_SIZE - len, "foreign 0x%02x %u\n", i, count);
+        }
+    }
+
+    for (i = 0; i < Q11K_REPORT_TYPES; i++)
+    {
+        u32 count = atomic_read(&stats->unhandled[i]);
+
+        if (count != 0)
+        {
+            len += scnprintf(buf + len, PAGE_SIZE - len, "0x%02x %u\n", i, count);
+        }
+    }
+
+    return len;
+}
+
+static ssize_t q11k_param_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct q11k_device* qdev = hid_get_drvdata(to_hid_device(dev));
+    struct q11k_param_attribute* pattr = container_of(attr, struct q11k_param_attribute, attr);
+    u32 v;
+
+    rcu_read_lock();
+    v = *(const u32*)((const char*)q11k_core_config(&qdev->state) + pattr->offset);
+    rcu_read_unlock();
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", v);
+}
+
+static ssize_t q11k_param_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct q11k_device* qdev = hid_get_drvdata(to_hid_device(dev));
+    struct q11k_param_attribute* pattr = container_of(attr, struct q11k_param_attribute, attr);
+    q11k_config_t* cfg;
+    u32 v;
+    int rc;
+
+    rc = kstrtou32(buf, 0, &v);
+    if (rc)
+    {
+        return rc;
+    }
+    if (v < pattr->min || v > pattr->max)
+    {
+        return -ERANGE;
+    }
+
+    mutex_lock(&qdev->config_lock);
+    cfg = q11k_config_dup(qdev);
+    if (cfg == NULL)
+    {
+        rc = -ENOMEM;
+        goto unlock;
+    }
+
+    *(u32*)((char*)cfg + pattr->offset) = v;
+    rc = (pattr->update != NULL) ? pattr->update(qdev, cfg) : 0;
+    if (rc)
+    {
+        kfree(cfg);
+        goto unlock;
+    }
+    q11k_config_publish(qdev, cfg);
+    if (pattr->published != NULL)
+    {
+        pattr->published(qdev, cfg);
+    }
+
+unlock:
+    mutex_unlock(&qdev->config_lock);
+    return rc ? rc : count;
+}
+
+static ssize_t pressure_curve_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct q11k_device* qdev = hid_get_drvdata(to_hid_device(dev));
+    ssize_t len;
+
+    mutex_lock(&qdev->config_lock);
+    len = scnprintf(buf, PAGE_SIZE, "%s\n", qdev->pressure_desc);
+    mutex_unlock(&qdev->config_lock);
+
+    return len;
+}
+
+/*
+ * The table is built before taking the lock and goes live with a new
+ * config; the old one is freed once no report can still use it.
+ */
+static ssize_t pressure_curve_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct q11k_device* qdev = hid_get_drvdata(to_hid_device(dev));
+    q11k_pressure_lut_t* lut = NULL;
+    q11k_config_t* cfg;
+    char desc[Q11K_PRESSURE_DESC_SIZE];
+    int rc;
+
+    if (sysfs_streq(buf, "linear"))
+    {
+        strscpy(desc, "linear", sizeof(desc));
+    }
+    else
+    {
+        lut = kmalloc(sizeof(*lut), GFP_KERNEL);
+        if (lut == NULL)
+        {
+            return -ENOMEM;
+        }
+
+        rc = q11k_parse_pressure_curve(buf, lut, desc);
+        if (rc)
+        {
+            kfree(lut);
+            return rc;
+        }
+    }
+
+    mutex_lock(&qdev->config_lock);
+    cfg = q11k_config_dup(qdev);
+    if (cfg == NULL)
+    {
+        mutex_unlock(&qdev->config_lock);
+        kfree(lut);
+        return -ENOMEM;
+    }
+
+    cfg->pressure = lut;
+    q11k_config_publish(qdev, cfg);
+    strscpy(qdev->pressure_desc, desc, sizeof(qdev->pressure_desc));
+    mutex_unlock(&qdev->config_lock);
+
+    return count;
+}
+
+/*
+ * "bezier X1 Y1 X2 Y2" (control points in percent) or a list of up to
+ * Q11K_PRESSURE_MAX_POINTS "IN:OUT" pairs in pressure units. @desc gets
+ * the curve back in canonical form.
+ */
+static int q11k_parse_pressure_curve(const char* buf, q11k_pressure_lut_t* lut, char* desc)
+{
+    u32 in[Q11K_PRESSURE_MAX_POINTS];
+    u32 out[Q11K_PRESSURE_MAX_POINTS];
+    u32 cp[4];
+    int len = 0;
+    int n = 0;
+    int rc;
+
+    if (sscanf(buf, " bezier %u %u %u %u %n", &cp[0], &cp[1], &cp[2], &cp[3], &len) == 4 && buf[len] == '\0')
+    {
+        rc = q11k_pressure_lut_bezier(lut, cp);
+        if (rc == 0)
+        {
+            snprintf(desc, Q11K_PRESSURE_DESC_SIZE, "bezier %u %u %u %u", cp[0], cp[1], cp[2], cp[3]);
+        }
+        return rc;
+    }
+
+    while (n < Q11K_PRESSURE_MAX_POINTS && sscanf(buf, " %u:%u %n", &in[n], &out[n], &len) == 2)
+    {
+        buf += len;
+        n++;
+    }
+    if (n == 0 || *buf != '\0')
+    {
+        return -EINVAL;
+    }
+
+    rc = q11k_pressure_lut_points(lut, in, out, n);
+    if (rc == 0)
+    {
+        int i;
+
+        len = 0;
+        for (i = 0; i < n; i++)
+        {
+            len += scnprintf(desc + len, Q11K_PRESSURE_DESC_SIZE - len, "%s%u:%u", i ? " " : "", in[i], out[i]);
+        }
+    }
+    return rc;
+}
+
+/* The live config, called with config_lock held */
+static q11k_config_t* q11k_config_locked(struct q11k_device* qdev)
+{
+    return rcu_dereference_protected(qdev->state.config, lockdep_is_held(&qdev->config_lock));
+}
+
+/* A private copy of the live config to build the next one on */
+static q11k_config_t* q11k_config_dup(struct q11k_device* qdev)
+{
+    return kmemdup(q11k_config_locked(qdev), sizeof(q11k_config_t), GFP_KERNEL);
+}
+
+/*
+ * Make @cfg the live config, called with config_lock held. Reports that
+ * already picked up the old one finish on it; it is freed, along with a
+ * pressure curve @cfg no longer uses, once they are done.
+ */
+static void q11k_config_publish(struct q11k_device* qdev, q11k_config_t* cfg)
+{
+    q11k_config_t* old = q11k_config_locked(qdev);
+
+    rcu_assign_pointer(qdev->state.config, cfg);
+    synchronize_rcu();
+
+    if (old->pressure != cfg->pressure)
+    {
+        kfree(old->pressure);
+    }
+    if (old != &qdev->state.default_config)
+    {
+        kfree(old);
+    }
+}
+
+/*
+ * Rebuild the area matrix of @cfg, called with config_lock held. Once it
+ * compiled @cfg is published, so the ranges already grow to what it maps
+ * to; reports still mapped with the old matrix stay within them too.
+ */
+static int q11k_area_update(struct q11k_device* qdev, q11k_config_t* cfg)
+{
+    int rc = q11k_area_compile(&cfg->area, &cfg->area_matrix);
+
+    if (rc == 0)
+    {
+        q11k_update_abs_ranges(qdev, cfg, true);
+    }
+    return rc;
+}
+
+/* Shrink the ranges to @cfg once no report is mapped with the old matrix */
+static void q11k_area_published(struct q11k_device* qdev, const q11k_config_t* cfg)
+{
+    q11k_update_abs_ranges(qdev, cfg, false);
+}
+
+/*
+ * Advertise the output range of the active area on the pen device, or
+ * with @widen only grow the current ranges to cover it. Readers that
+ * cached the ranges at open time have to reopen the node. The minimum
+ * stays 0; event_lock keeps EVIOCGABS from seeing half an update.
+ */
+static void q11k_update_abs_ranges(struct q11k_device* qdev, const q11k_config_t* cfg, bool widen)
+{
+    const q11k_area_matrix_t* m = &cfg->area_matrix;
+    struct input_dev* dev;
+
+    rcu_read_lock();
+    dev = rcu_dereference(qdev->idev[Q11K_INPUT_PEN]);
+    if (dev != NULL)
+    {
+        spin_lock_irq(&dev->event_lock);
+        if (!widen || m->max_x > input_abs_get_max(dev, ABS_X))
+        {
+            input_abs_set_max(dev, ABS_X, m->max_x);
+        }
+        if (!widen || m->max_y > input_abs_get_max(dev, ABS_Y))
+        {
+            input_abs_set_max(dev, ABS_Y, m->max_y);
+        }
+        spin_unlock_irq(&dev->event_lock);
+    }
+    rcu_read_unlock();
+}
+
+/*
+ * Event sink of the core. An input device that is not registered (yet,
+ * or any more) silently drops its events; the report path holds the RCU
+ * read lock, so it never sees a device that is being unregistered.
+ */
+static void q11k_sink_report_key(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    struct q11k_device* qdev = ctx;
+    struct input_dev* dev = rcu_dereference(qdev->idev[idev]);
+
+    if (dev != NULL)
+    {
+        input_report_key(dev, code, value);
+    }
+}
+
+static void q11k_sink_report_abs(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    struct q11k_device* qdev = ctx;
+    struct input_dev* dev = rcu_dereference(qdev->idev[idev]);
+
+    if (dev != NULL)
+    {
+        input_report_abs(dev, code, value);
+    }
+}
+
+static void q11k_sink_report_msc(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    struct q11k_device* qdev = ctx;
+    struct input_dev* dev = rcu_dereference(qdev->idev[idev]);
+
+    if (dev != NULL)
+    {
+        input_event(dev, EV_MSC, code, value);
+    }
+}
+
+static void q11k_sink_report_rel(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    struct q11k_device* qdev = ctx;
+    struct input_dev* dev = rcu_dereference(qdev->idev[idev]);
+
+    if (dev != NULL)
+    {
+        input_report_rel(dev, code, value);
+    }
+}
+
+static void q11k_sink_sync_dev(void* ctx, enum q11k_input idev, u64 time_ns)
+{
+    struct q11k_device* qdev = ctx;
+    struct input_dev* dev = rcu_dereference(qdev->idev[idev]);
+
+    if (dev != NULL)
+    {
+        trace_q11k_frame(&qdev->state, idev);
+        input_set_timestamp(dev, ns_to_ktime(time_ns));
+        input_sync(dev);
+    }
+}
+
+/*
+ * Publish a pen frame on the sample channel. Runs under pen_lock, so it is
+ * the ring's only writer; clients are walked under the report path's RCU
+ * read lock.
+ */
+static void q11k_sink_pen_frame_dev(void* ctx, const q11k_pen_frame_t* frame, u64 time_ns)
+{
+    struct q11k_device* qdev = ctx;
+    q11k_sample_ring_t* ring = qdev->samples;
+    q11k_sample_client_t* client;
+    q11k_sample_t* e;
+    u64 seq;
+
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    seq = ring->head + 1;
+    e = &ring->e[(seq - 1) & (ring->entries - 1)];
+
+    WRITE_ONCE(e->seq, 0);
+    smp_wmb();
+    e->t_ns = time_ns;
+    e->x = frame->x;
+    e->y = frame->y;
+    e->pressure = frame->pressure;
+    e->prox = frame->prox;
+    e->buttons = (frame->stylus ? Q11K_SAMPLE_STYLUS : 0) | (frame->stylus2 ? Q11K_SAMPLE_STYLUS2 : 0);
+    smp_store_release(&e->seq, seq);
+    smp_store_release(&ring->head, seq);
+
+    if (wq_has_sleeper(&qdev->sample_wait))
+    {
+        wake_up_interruptible(&qdev->sample_wait);
+    }
+
+    list_for_each_entry_rcu(client, &qdev->sample_clients, node)
+    {
+        struct eventfd_ctx* efd = rcu_dereference(client->eventfd);
+
+        if (efd != NULL)
+        {
+            eventfd_signal(efd);
+        }
+    }
+}
+
+static void q11k_debug_hist_show(struct seq_file *m, const char* name, const u64* hist)
+{
+    int i;
+
+    seq_printf(m, "%s\n", name);
+    for (i = 0; i < Q11K_HIST_BUCKETS; i++)
+    {
+        if (hist[i] != 0)
+        {
+            seq_printf(m, "  %llu-%llu %llu\n", (i == 0) ? 0 : 1ull << (i - 1),
+                       (i == 0) ? 0 : (1ull << i) - 1, hist[i]);
+        }
+    }
+}
+
+/*
+ * "type count" per report type seen, the drop counters of the core,
+ * then the histograms as "low-high count" lines in nanoseconds.
+ */
+static int q11k_debug_stats_show(struct seq_file *m, void *unused)
+{
+    struct q11k_device* qdev = m->private;
+    const q11k_report_stats_t* dropped = &qdev->state.stats;
+    q11k_debug_stats_t* sum;
+    int cpu, i, j;
+
+    sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+    if (sum == NULL)
+    {
+        return -ENOMEM;
+    }
+
+    for_each_possible_cpu(cpu)
+    {
+        const q11k_debug_stats_t* s = per_cpu_ptr(qdev->debug_stats, cpu);
+
+        for (i = 0; i < Q11K_REPORT_TYPES; i++)
+        {
+            sum->reports[i] += READ_ONCE(s->reports[i]);
+        }
+        for (i = 0; i < Q11K_HIST_BUCKETS; i++)
+        {
+            for (j = 0; j < Q11K_IFACE_COUNT; j++)
+            {
+                sum->interval[j][i] += READ_ONCE(s->interval[j][i]);
+            }
+            sum->process[i] += READ_ONCE(s->process[i]);
+        }
+    }
+
+    seq_puts(m, "reports\n");
+    for (i = 0; i < Q11K_REPORT_TYPES; i++)
+    {
+        if (sum->reports[i] != 0)
+        {
+            seq_printf(m, "  0x%02x %llu\n", i, sum->reports[i]);
+        }
+    }
+    seq_printf(m, "dropped\n  truncated %u\n  misrouted %u\n",
+               atomic_read(&dropped->truncated), atomic_read(&dropped->misrouted));
+    for (i = 0; i < Q11K_REPORT_IDS; i++)
+    {
+        if (atomic_read(&dropped->foreign[i]) != 0)
+        {
+            seq_printf(m, "  foreign 0x%02x %u\n", i, atomic_read(&dropped->foreign[i]));
+        }
+    }
+
+    q11k_debug_hist_show(m, "interval_pad_ns", sum->interval[Q11K_IFACE_PAD]);
+    q11k_debug_hist_show(m, "interval_pen_ns", sum->interval[Q11K_IFACE_PEN]);
+    q11k_debug_hist_show(m, "process_ns", sum->process);
+
+    kfree(sum);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(q11k_debug_stats);
+
+/* Any write clears the statistics and the drop counters of dropped_reports */
+static ssize_t q11k_debug_reset_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    struct q11k_device* qdev = file->private_data;
+    int cpu, i;
+
+    for_each_possible_cpu(cpu)
+    {
+        memset(per_cpu_ptr(qdev->debug_stats, cpu), 0, sizeof(q11k_debug_stats_t));
+    }
+    atomic_set(&qdev->state.stats.truncated, 0);
+    atomic_set(&qdev->state.stats.misrouted, 0);
+    for (i = 0; i < Q11K_REPORT_IDS; i++)
+    {
+        atomic_set(&qdev->state.stats.foreign[i], 0);
+    }
+    for (i = 0; i < Q11K_REPORT_TYPES; i++)
+    {
+        atomic_set(&qdev->state.stats.unhandled[i], 0);
+    }
+
+    return count;
+}
+
+static const struct file_operations q11k_debug_reset_fops = {
+    .owner = THIS_MODULE,
+    .open  = simple_open,
+    .write = q11k_debug_reset_write,
+};
+
+/*
+ * Streams q11k_record_t entries; the file position is the sequence number
+ * times the entry size. A reader that fell behind skips to the oldest
+ * entry still in the ring, and reads 0 once it has caught up.
+ */
+static ssize_t q11k_record_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct q11k_device* qdev = file->private_data;
+    q11k_record_ring_t* ring;
+    u64 seq = div_u64(*ppos, sizeof(q11k_record_t));
+    u64 head;
+    size_t done = 0;
+    ssize_t rc = 0;
+
+    if (count < sizeof(q11k_record_t))
+    {
+        return -EINVAL;
+    }
+
+    mutex_lock(&qdev->config_lock);
+    ring = rcu_dereference_protected(qdev->record, lockdep_is_held(&qdev->config_lock));
+    if (ring == NULL)
+    {
+        rc = -ENODATA;
+        goto out;
+    }
+
+    head = atomic64_read(&qdev->record_seq);
+    if (head > ring->entries && seq < head - ring->entries)
+    {
+        seq = head - ring->entries;
+    }
+
+    while (seq < head && done + sizeof(q11k_record_t) <= count)
+    {
+        const q11k_record_t* e = &ring->e[seq & (ring->entries - 1)];
+        q11k_record_t copy;
+        u64 s1, s2;
+
+        s1 = smp_load_acquire(&e->seq);
+        memcpy(&copy, e, sizeof(copy));
+        smp_rmb();
+        s2 = READ_ONCE(e->seq);
+
+        if (s1 < seq + 1)
+        {
+            /* reserved but not written yet */
+            break;
+        }
+        if (s1 == seq + 1 && s2 == s1)
+        {
+            if (copy_to_user(buf + done, &copy, sizeof(copy)))
+            {
+                rc = -EFAULT;
+                break;
+            }
+            done += sizeof(copy);
+        }
+        /* else overwritten since head was read */
+        seq++;
+    }
+    *ppos = seq * sizeof(q11k_record_t);
+
+out:
+    mutex_unlock(&qdev->config_lock);
+    return done ? done : rc;
+}
+
+/*
+ * Read-only view of the ring (q11k_record_ring_t). A mapping keeps the
+ * ring it was made from; map again after changing record_entries.
+ */
+static int q11k_record_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct q11k_device* qdev = file->private_data;
+    q11k_record_ring_t* ring;
+    int rc;
+
+    if (vma->vm_flags & VM_WRITE)
+    {
+        return -EPERM;
+    }
+    /* nor may it become writable through mprotect() */
+    vm_flags_clear(vma, VM_MAYWRITE);
+
+    mutex_lock(&qdev->config_lock);
+    ring = rcu_dereference_protected(qdev->record, lockdep_is_held(&qdev->config_lock));
+    rc = (ring != NULL) ? remap_vmalloc_range(vma, ring, vma->vm_pgoff) : -ENODATA;
+    mutex_unlock(&qdev->config_lock);
+
+    return rc;
+}
+
+static const struct file_operations q11k_record_fops = {
+    .owner  = THIS_MODULE,
+    .open   = simple_open,
+    .read   = q11k_record_read,
+    .mmap   = q11k_record_mmap,
+    .llseek = default_llseek,
+};
+
+static ssize_t q11k_record_entries_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct q11k_device* qdev = file->private_data;
+    q11k_record_ring_t* ring;
+    char tmp[16];
+    int len;
+
+    mutex_lock(&qdev->config_lock);
+    ring = rcu_dereference_protected(qdev->record, lockdep_is_held(&qdev->config_lock));
+    len = scnprintf(tmp, sizeof(tmp), "%u\n", (ring != NULL) ? ring->entries : 0);
+    mutex_unlock(&qdev->config_lock);
+
+    return simple_read_from_buffer(buf, count, ppos, tmp, len);
+}
+
+/* 0 stops recording; any other write starts over with an empty ring */
+static ssize_t q11k_record_entries_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    struct q11k_device* qdev = file->private_data;
+    q11k_record_ring_t* ring = NULL;
+    q11k_record_ring_t* old;
+    u32 entries;
+    int rc;
+
+    rc = kstrtou32_from_user(buf, count, 0, &entries);
+    if (rc)
+    {
+        return rc;
+    }
+    if (entries != 0 && (!is_power_of_2(entries) || entries < Q11K_RECORD_MIN_ENTRIES
+                         || entries > Q11K_RECORD_MAX_ENTRIES))
+    {
+        return -EINVAL;
+    }
+
+    if (entries != 0)
+    {
+        ring = vmalloc_user(q11k_record_ring_size(entries));
+        if (ring == NULL)
+        {
+            return -ENOMEM;
+        }
+        ring->magic = Q11K_RECORD_MAGIC;
+        ring->entries = entries;
+    }
+
+    mutex_lock(&qdev->config_lock);
+    old = rcu_dereference_protected(qdev->record, lockdep_is_held(&qdev->config_lock));
+    RCU_INIT_POINTER(qdev->record, NULL);
+    synchronize_rcu();
+    atomic64_set(&qdev->record_seq, 0);
+    rcu_assign_pointer(qdev->record, ring);
+    mutex_unlock(&qdev->config_lock);
+
+    vfree(old);
+    return count;
+}
+
+static const struct file_operations q11k_record_entries_fops = {
+    .owner = THIS_MODULE,
+    .open  = simple_open,
+    .read  = q11k_record_entries_read,
+    .write = q11k_record_entries_write,
+};
+
+static void q11k_debugfs_add(struct q11k_device* qdev)
+{
+    char name[sizeof(qdev->phys)];
+
+    strscpy(name, qdev->phys, sizeof(name));
+    strreplace(name, '/', '_');
+
+    qdev->debugfs_dir = debugfs_create_dir(name, q11k_debugfs_root);
+    debugfs_create_file("stats", 0444, qdev->debugfs_dir, qdev, &q11k_debug_stats_fops);
+    debugfs_create_file("reset", 0200, qdev->debugfs_dir, qdev, &q11k_debug_reset_fops);
+    debugfs_create_file("record", 0400, qdev->debugfs_dir, qdev, &q11k_record_fops);
+    debugfs_create_file("record_entries", 0600, qdev->debugfs_dir, qdev, &q11k_record_entries_fops);
+}
+
+static q11k_sample_ring_t* q11k_sample_ring_alloc(void)
+{
+    u32 entries = clamp_t(u32, pen_samples, Q11K_SAMPLE_MIN_ENTRIES, Q11K_SAMPLE_MAX_ENTRIES);
+    q11k_sample_ring_t* ring;
+
+    entries = roundup_pow_of_two(entries);
+    ring = vmalloc_user(q11k_sample_ring_size(entries));
+    if (ring != NULL)
+    {
+        ring->magic = Q11K_SAMPLE_MAGIC;
+        ring->entries = entries;
+    }
+    return ring;
+}
+
+static const struct file_operations q11k_sample_fops = {
+    .owner          = THIS_MODULE,
+    .open           = q11k_sample_open,
+    .release        = q11k_sample_release,
+    .read           = q11k_sample_read,
+    .poll           = q11k_sample_poll,
+    .mmap           = q11k_sample_mmap,
+    .unlocked_ioctl = q11k_sample_ioctl,
+};
+
+/* The channel is optional, so a failure here leaves the tablet working */
+static void q11k_register_samples(struct q11k_device* qdev, struct hid_device *hdev)
+{
+    int rc;
+
+    if (qdev->samples == NULL)
+    {
+        return;
+    }
+
+    qdev->sample_id = ida_alloc(&q11k_sample_ida, GFP_KERNEL);
+    if (qdev->sample_id < 0)
+    {
+        hid_warn(hdev, "no pen sample channel: %d\n", qdev->sample_id);
+        return;
+    }
+
+    snprintf(qdev->sample_name, sizeof(qdev->sample_name), "q11k_pen%d", qdev->sample_id);
+    memset(&qdev->sample_misc, 0, sizeof(qdev->sample_misc));
+    qdev->sample_misc.minor  = MISC_DYNAMIC_MINOR;
+    qdev->sample_misc.name   = qdev->sample_name;
+    qdev->sample_misc.fops   = &q11k_sample_fops;
+    qdev->sample_misc.parent = &hdev->dev;
+
+    mutex_lock(&qdev->config_lock);
+    qdev->samples_gone = false;
+    mutex_unlock(&qdev->config_lock);
+
+    rc = misc_register(&qdev->sample_misc);
+    if (rc)
+    {
+        hid_warn(hdev, "no pen sample channel: %d\n", rc);
+        ida_free(&q11k_sample_ida, qdev->sample_id);
+        return;
+    }
+    qdev->sample_registered = true;
+}
+
+/*
+ * The pen is going away: drop the clients' I/O references and wake them
+ * with EPOLLHUP. Open files keep the device (and the ring they may have
+ * mapped) until they are closed.
+ */
+static void q11k_unregister_samples(struct q11k_device* qdev)
+{
+    q11k_sample_client_t* client;
+
+    if (!qdev->sample_registered)
+    {
+        return;
+    }
+
+    mutex_lock(&qdev->config_lock);
+    qdev->samples_gone = true;
+    list_for_each_entry(client, &qdev->sample_clients, node)
+    {
+        if (client->hw_open)
+        {
+            hid_hw_close(qdev->pen_hdev);
+            client->hw_open = false;
+        }
+    }
+    mutex_unlock(&qdev->config_lock);
+    wake_up_interruptible_all(&qdev->sample_wait);
+
+    misc_deregister(&qdev->sample_misc);
+    ida_free(&q11k_sample_ida, qdev->sample_id);
+    qdev->sample_registered = false;
+}
+
+/* Like an open input device, an open channel keeps the pen polled */
+static int q11k_sample_open(struct inode *inode, struct file *file)
+{
+    struct q11k_device* qdev = container_of(file->private_data, struct q11k_device, sample_misc);
+    q11k_sample_client_t* client;
+    int rc;
+
+    client = kzalloc(sizeof(*client), GFP_KERNEL);
+    if (client == NULL)
+    {
+        return -ENOMEM;
+    }
+    client->qdev = qdev;
+    client->seen = smp_load_acquire(&qdev->samples->head);
+
+    mutex_lock(&qdev->config_lock);
+    if (qdev->samples_gone)
+    {
+        rc = -ENODEV;
+        goto err_unlock;
+    }
+    rc = hid_hw_open(qdev->pen_hdev);
+    if (rc)
+    {
+        goto err_unlock;
+    }
+    client->hw_open = true;
+    kref_get(&qdev->kref);
+    list_add_tail_rcu(&client->node, &qdev->sample_clients);
+    mutex_unlock(&qdev->config_lock);
+
+    file->private_data = client;
+    return stream_open(inode, file);
+
+err_unlock:
+    mutex_unlock(&qdev->config_lock);
+    kfree(client);
+    return rc;
+}
+
+static int q11k_sample_release(struct inode *inode, struct file *file)
+{
+    q11k_sample_client_t* client = file->private_data;
+    struct q11k_device* qdev = client->qdev;
+    struct eventfd_ctx* efd;
+
+    mutex_lock(&qdev->config_lock);
+    list_del_rcu(&client->node);
+    if (client->hw_open)
+    {
+        hid_hw_close(qdev->pen_hdev);
+    }
+    efd = rcu_dereference_protected(client->eventfd, lockdep_is_held(&qdev->config_lock));
+    mutex_unlock(&qdev->config_lock);
+
+    synchronize_rcu();
+    if (efd != NULL)
+    {
+        eventfd_ctx_put(efd);
+    }
+    kfree(client);
+    q11k_device_put(qdev);
+    return 0;
+}
+
+static bool q11k_sample_ready(q11k_sample_client_t* client)
+{
+    return smp_load_acquire(&client->qdev->samples->head) != client->seen
+        || READ_ONCE(client->qdev->samples_gone);
+}
+
+/*
+ * Returns the head as a u64 once there are samples the file has not
+ * seen; 0 after the tablet went away.
+ */
+static ssize_t q11k_sample_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    q11k_sample_client_t* client = file->private_data;
+    struct q11k_device* qdev = client->qdev;
+    u64 head;
+    int rc;
+
+    if (count < sizeof(head))
+    {
+        return -EINVAL;
+    }
+
+    if (!q11k_sample_ready(client))
+    {
+        if (file->f_flags & O_NONBLOCK)
+        {
+            return -EAGAIN;
+        }
+        rc = wait_event_interruptible(qdev->sample_wait, q11k_sample_ready(client));
+        if (rc)
+        {
+            return rc;
+        }
+    }
+
+    head = smp_load_acquire(&qdev->samples->head);
+    if (head == client->seen)
+    {
+        return 0;
+    }
+    if (put_user(head, (u64 __user *)buf))
+    {
+        return -EFAULT;
+    }
+    client->seen = head;
+    return sizeof(head);
+}
+
+static __poll_t q11k_sample_poll(struct file *file, poll_table *wait)
+{
+    q11k_sample_client_t* client = file->private_data;
+    struct q11k_device* qdev = client->qdev;
+    __poll_t mask = 0;
+
+    poll_wait(file, &qdev->sample_wait, wait);
+    if (smp_load_acquire(&qdev->samples->head) != client->seen)
+    {
+        mask |= EPOLLIN | EPOLLRDNORM;
+    }
+    if (READ_ONCE(qdev->samples_gone))
+    {
+        mask |= EPOLLHUP;
+    }
+    return mask;
+}
+
+/* Read-only view of the ring (q11k_sample_ring_t) */
+static int q11k_sample_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    q11k_sample_client_t* client = file->private_data;
+
+    if (vma->vm_flags & VM_WRITE)
+    {
+        return -EPERM;
+    }
+    /* nor may it become writable through mprotect() */
+    vm_flags_clear(vma, VM_MAYWRITE);
+    return remap_vmalloc_range(vma, client->qdev->samples, vma->vm_pgoff);
+}
+
+static long q11k_sample_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    q11k_sample_client_t* client = file->private_data;
+    struct q11k_device* qdev = client->qdev;
+    struct eventfd_ctx* efd = NULL;
+    struct eventfd_ctx* old;
+    int fd;
+
+    if (cmd != Q11K_SAMPLE_IOC_SET_EVENTFD)
+    {
+        return -ENOTTY;
+    }
+    if (get_user(fd, (int __user *)arg))
+    {
+        return -EFAULT;
+    }
+    if (fd >= 0)
+    {
+        efd = eventfd_ctx_fdget(fd);
+        if (IS_ERR(efd))
+        {
+            return PTR_ERR(efd);
+        }
+    }
+
+    mutex_lock(&qdev->config_lock);
+    old = rcu_dereference_protected(client->eventfd, lockdep_is_held(&qdev->config_lock));
+    rcu_assign_pointer(client->eventfd, efd);
+    mutex_unlock(&qdev->config_lock);
+
+    if (old != NULL)
+    {
+        synchronize_rcu();
+        eventfd_ctx_put(old);
+    }
+    return 0;
+}
+
+#ifdef CONFIG_PM
+static int uclogic_resume(struct hid_device *hdev)
+{
+	return 0;
+}
+#endif
+
+static void __close_input(struct q11k_device* qdev, enum q11k_input idev)
+{
+    struct input_dev* dev = rcu_dereference_protected(qdev->idev[idev], true);
+
+    if (dev != NULL)
+    {
+        RCU_INIT_POINTER(qdev->idev[idev], NULL);
+        synchronize_rcu();
+        input_unregister_device(dev);
+    }
+}
+
+static void __close_keyboard(struct q11k_device* qdev)
+{
+    __close_input(qdev, Q11K_INPUT_SCROLL);
+    __close_input(qdev, Q11K_INPUT_KEYBOARD);
+    DPRINT("Q11K keyboard unregistered");
+}
+
+static void __close_pad(struct q11k_device* qdev)
+{
+    q11k_unregister_samples(qdev);
+    __close_input(qdev, Q11K_INPUT_PEN);
+    DPRINT("Q11K tab unregistered");
+}
+
+void q11k_remove(struct hid_device *dev)
+{
+    struct q11k_device* qdev = hid_get_drvdata(dev);
+    int if_number = q11k_interface_number(dev);
+
+    sysfs_remove_groups(&dev->dev.kobj, q11k_attr_groups);
+
+    /* unregistering closes the input devices, and with them the I/O */
+    if (if_number == 0) {
+        cancel_work_sync(&qdev->strings_work);
+        qdev->usb_dev = NULL;
+        __close_keyboard(qdev);
+    } else if (if_number == 1) {
+        __close_pad(qdev);
+    }
+
+    hid_hw_stop(dev);
+
+    /* the pad interface may stay bound; the pen's timer must not outlive
+       it, and only once the I/O has stopped (an open hidraw keeps it
+       running) can no late report re-arm it */
+    if (if_number == 1) {
+        hrtimer_cancel(&qdev->prox_timer);
+    }
+
+    q11k_device_put(qdev);
+}
+
+struct wacom_features
+{
+	const char *name;
+	int x_max;
+	int y_max;
+	int pressure_max;
+	int distance_max;
+	int type;
+	int x_resolution;
+	int y_resolution;
+	int numbered_buttons;
+	int offset_left;
+	int offset_right;
+	int offset_top;
+	int offset_bottom;
+	int device_type;
+	int x_phy;
+	int y_phy;
+	unsigned unit;
+	int unitExpo;
+	int x_fuzz;
+	int y_fuzz;
+	int pressure_fuzz;
+	int distance_fuzz;
+	int tilt_fuzz;
+	unsigned quirks;
+	unsigned touch_max;
+	int oVid;
+	int oPid;
+	int pktlen;
+	bool check_for_hid_type;
+	int hid_type;
+};
+
+static const struct wacom_features wfs =
+	{ "Wacom Penpartner", 55662, 34789, 8192, 0, 4, 40, 40 };
+
+static const struct hid_device_id q11k_device[] = {
+    { HID_USB_DEVICE(USB_VENDOR_ID_HUION, USB_DEVICE_ID_HUION_TABLET), .driver_data = (kernel_ulong_t)&wfs },
+    {}
+};
+
+static struct hid_driver q11k_driver = {
+	.name                  = MODULENAME,
+	.id_table              = q11k_device,
+	.probe                 = q11k_probe,
+    .remove                = q11k_remove,
+	.raw_event             = q11k_raw_event,
+    .driver = {
+        .probe_type        = PROBE_PREFER_ASYNCHRONOUS,
+    },
+#ifdef CONFIG_PM
+	.resume	               = uclogic_resume,
+	.reset_resume          = uclogic_resume,
+#endif
+};
+
+static int __init q11k_init(void)
+{
+    int rc;
+
+    q11k_debugfs_root = debugfs_create_dir(MODULENAME, NULL);
+    rc = hid_register_driver(&q11k_driver);
+    if (rc)
+    {
+        debugfs_remove_recursive(q11k_debugfs_root);
+    }
+    return rc;
+}
+
+static void __exit q11k_exit(void)
+{
+    hid_unregister_driver(&q11k_driver);
+    debugfs_remove_recursive(q11k_debugfs_root);
+}
+
+module_init(q11k_init);
+module_exit(q11k_exit);
+
+MODULE_AUTHOR("Konata Izumi <konachan.700@gmail.com>");
+MODULE_DESCRIPTION("Huion Q11K device driver");
+MODULE_LICENSE("GPL");
+MODULE_VERSION("1.0.0");
+
+MODULE_DEVICE_TABLE(hid, q11k_device);
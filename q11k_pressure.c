@@ -0,0 +1,106 @@
+#include "q11k_core.h"
+
+/* Samples of the Bezier, joined by straight lines in the table */
+#define Q11K_PRESSURE_BEZIER_STEPS  256
+
+/* Fill lut->out[x0..x1] on the line from (x0, y0) to (x1, y1) */
+static void q11k_pressure_lut_segment(q11k_pressure_lut_t* lut, u32 x0, u32 y0, u32 x1, u32 y1)
+{
+    u32 x;
+
+    if (x1 == x0)
+    {
+        lut->out[x0] = y1;
+        return;
+    }
+
+    for (x = x0; x <= x1; x++)
+    {
+        s64 dy = ((s64)y1 - y0) * (x - x0);
+
+        lut->out[x] = y0 + (int)div_s64(dy + (x1 - x0) / 2, x1 - x0);
+    }
+}
+
+int q11k_pressure_lut_bezier(q11k_pressure_lut_t* lut, const u32 cp[4])
+{
+    const u64 n = Q11K_PRESSURE_BEZIER_STEPS;
+    const u64 scale = n * n * n * Q11K_PRESSURE_BEZIER_MAX;
+    u32 last_x = 0, last_y = 0;
+    u64 k;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        if (cp[i] > Q11K_PRESSURE_BEZIER_MAX)
+        {
+            return -EINVAL;
+        }
+    }
+
+    lut->out[0] = 0;
+    for (k = 1; k <= n; k++)
+    {
+        /* B(t) = 3(1-t)^2 t P1 + 3(1-t) t^2 P2 + t^3 P3, t = k/n */
+        u64 s = n - k;
+        u64 bx = 3 * s * s * k * cp[0] + 3 * s * k * k * cp[2] + k * k * k * Q11K_PRESSURE_BEZIER_MAX;
+        u64 by = 3 * s * s * k * cp[1] + 3 * s * k * k * cp[3] + k * k * k * Q11K_PRESSURE_BEZIER_MAX;
+        u32 x = (u32)div64_u64(bx * MAX_ABS_PRESSURE + scale / 2, scale);
+        u32 y = (u32)div64_u64(by * MAX_ABS_PRESSURE + scale / 2, scale);
+
+        /* x(t) never decreases with control points inside the square;
+           samples that do not advance it are skipped */
+        if (x > last_x)
+        {
+            q11k_pressure_lut_segment(lut, last_x, last_y, x, y);
+            last_x = x;
+            last_y = y;
+        }
+    }
+    lut->out[MAX_ABS_PRESSURE] = MAX_ABS_PRESSURE;
+
+    return 0;
+}
+
+int q11k_pressure_lut_points(q11k_pressure_lut_t* lut, const u32* in, const u32* out, int n)
+{
+    u32 last_x = 0, last_y = 0;
+    int i;
+
+    if (n < 1 || n > Q11K_PRESSURE_MAX_POINTS)
+    {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        if (in[i] > MAX_ABS_PRESSURE || out[i] > MAX_ABS_PRESSURE
+            || (i > 0 && in[i] <= in[i - 1]))
+        {
+            return -EINVAL;
+        }
+    }
+
+    if (in[0] == 0)
+    {
+        last_y = out[0];
+    }
+    lut->out[0] = last_y;
+
+    for (i = 0; i < n; i++)
+    {
+        if (in[i] != 0)
+        {
+            q11k_pressure_lut_segment(lut, last_x, last_y, in[i], out[i]);
+        }
+        last_x = in[i];
+        last_y = out[i];
+    }
+
+    if (last_x != MAX_ABS_PRESSURE)
+    {
+        q11k_pressure_lut_segment(lut, last_x, last_y, MAX_ABS_PRESSURE, MAX_ABS_PRESSURE);
+    }
+
+    return 0;
+}
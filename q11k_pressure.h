@@ -0,0 +1,49 @@
+/*
+ * Pressure response curve: a table with one output pressure per raw
+ * pressure, built from a cubic Bezier or a point list when the curve is
+ * set, so a sample costs one lookup. Included by q11k_core.h.
+ */
+#ifndef __Q11K_PRESSURE_H
+#define __Q11K_PRESSURE_H
+
+#define Q11K_PRESSURE_LUT_SIZE      (MAX_ABS_PRESSURE + 1)
+#define Q11K_PRESSURE_MAX_POINTS    16
+
+/* Bezier control points are in percent of the pressure range */
+#define Q11K_PRESSURE_BEZIER_MAX    100
+
+typedef struct __tag_q11k_pressure_lut_t
+{
+    u16 out[Q11K_PRESSURE_LUT_SIZE];
+} q11k_pressure_lut_t;
+
+/*
+ * Cubic Bezier from (0, 0) to (100, 100) through the control points
+ * (@cp[0], @cp[1]) and (@cp[2], @cp[3]), like the Wacom PressureCurve.
+ * Returns -EINVAL if a coordinate is above 100.
+ */
+int q11k_pressure_lut_bezier(q11k_pressure_lut_t* lut, const u32 cp[4]);
+
+/*
+ * Piecewise linear through @n (@in, @out) pairs in pressure units, with
+ * strictly increasing @in. (0, 0) and (MAX, MAX) are implied if the list
+ * does not start at 0 or end at MAX_ABS_PRESSURE. Returns -EINVAL for an
+ * unusable list.
+ */
+int q11k_pressure_lut_points(q11k_pressure_lut_t* lut, const u32* in, const u32* out, int n);
+
+static inline int q11k_pressure_map(const q11k_pressure_lut_t* lut, int pressure)
+{
+    if (pressure < 0)
+    {
+        pressure = 0;
+    }
+    else if (pressure > MAX_ABS_PRESSURE)
+    {
+        pressure = MAX_ABS_PRESSURE;
+    }
+
+    return lut->out[pressure];
+}
+
+#endif
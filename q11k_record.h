@@ -0,0 +1,45 @@
+/*
+ * Recording ring of raw reports, shared by the module (debugfs "record")
+ * and tools/q11k_replay.c.
+ *
+ * The ring keeps the last @entries reports of both interfaces. Writers
+ * reserve a sequence number and own slot seq & (entries - 1) until they
+ * store seq + 1 into it; a reader that sees the same seq before and after
+ * copying an entry got it whole. Seq 0 is an empty or half-written slot.
+ */
+#ifndef __Q11K_RECORD_H
+#define __Q11K_RECORD_H
+
+#include "q11k_core.h"
+
+#define Q11K_RECORD_MAGIC           0x52313151      /* "Q11R" */
+#define Q11K_RECORD_HEADER_SIZE     64
+#define Q11K_RECORD_MIN_ENTRIES     64
+#define Q11K_RECORD_MAX_ENTRIES     (1 << 20)
+
+typedef struct __tag_q11k_record_t
+{
+    u64 seq;                        /* 1-based, see above */
+    u64 t_ns;                       /* arrival, CLOCK_MONOTONIC */
+    u8 report[Q11K_REPORT_SIZE];    /* zero padded, longer reports cut */
+    u8 size;                        /* size as received */
+    u8 iface;                       /* 0 pad, 1 pen */
+    u16 reserved;
+} q11k_record_t;
+
+/* What mmap() of the debugfs file shows */
+typedef struct __tag_q11k_record_ring_t
+{
+    u32 magic;
+    u32 entries;                    /* power of two */
+    u64 head;                       /* highest seq stored so far */
+    u8 reserved[Q11K_RECORD_HEADER_SIZE - 16];
+    q11k_record_t e[];
+} q11k_record_ring_t;
+
+static inline size_t q11k_record_ring_size(u32 entries)
+{
+    return Q11K_RECORD_HEADER_SIZE + (size_t)entries * sizeof(q11k_record_t);
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Pen sample channel, shared by the module (/dev/q11k_penN) and
+ * tools/q11k_samples.c.
+ *
+ * The pen report path is the only writer: for every pen frame it fills
+ * slot seq & (entries - 1), storing 0 into its seq first and seq last,
+ * then publishes seq as the head. Readers map the ring read-only, follow
+ * the head at their own pace and check that an entry's seq is the same
+ * before and after using it; one that changed was overwritten.
+ *
+ * read() of 8 bytes waits for samples newer than the head the file last
+ * returned and returns the current head, so poll() on the file works as
+ * a wakeup. Q11K_SAMPLE_IOC_SET_EVENTFD makes every sample add 1 to an
+ * eventfd instead (-1 detaches it).
+ */
+#ifndef __Q11K_SAMPLE_H
+#define __Q11K_SAMPLE_H
+
+#include <linux/ioctl.h>
+
+#include "q11k_core.h"
+
+#define Q11K_SAMPLE_MAGIC           0x53313151      /* "Q11S" */
+#define Q11K_SAMPLE_HEADER_SIZE     64
+#define Q11K_SAMPLE_MIN_ENTRIES     64
+#define Q11K_SAMPLE_MAX_ENTRIES     (1 << 16)
+
+#define Q11K_SAMPLE_IOC_SET_EVENTFD _IOW('Q', 0x01, int)
+
+/* q11k_sample_t.buttons */
+#define Q11K_SAMPLE_STYLUS          0x01
+#define Q11K_SAMPLE_STYLUS2         0x02
+
+typedef struct __tag_q11k_sample_t
+{
+    u64 seq;                        /* 1-based, see above */
+    u64 t_ns;                       /* report arrival, CLOCK_MONOTONIC */
+    s32 x;                          /* as reported on the pen device */
+    s32 y;
+    s32 pressure;
+    u8 prox;                        /* enum q11k_pen_prox */
+    u8 buttons;                     /* Q11K_SAMPLE_STYLUS* */
+    u16 reserved;
+} q11k_sample_t;
+
+/* What mmap() of the device shows */
+typedef struct __tag_q11k_sample_ring_t
+{
+    u32 magic;
+    u32 entries;                    /* power of two */
+    u64 head;                       /* seq of the newest sample */
+    u8 reserved[Q11K_SAMPLE_HEADER_SIZE - 16];
+    q11k_sample_t e[];
+} q11k_sample_ring_t;
+
+static inline size_t q11k_sample_ring_size(u32 entries)
+{
+    return Q11K_SAMPLE_HEADER_SIZE + (size_t)entries * sizeof(q11k_sample_t);
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Tracepoints of the report path, under events/q11k/ in tracefs.
+ *
+ * Every event carries the per-tablet state pointer as "dev", so the two
+ * interfaces of one tablet can be told apart from a second tablet.
+ * Disabled tracepoints are a static branch in the kernel and compile to
+ * nothing in the userspace build of the core.
+ */
+#ifndef __KERNEL__
+
+#ifndef __Q11K_TRACE_STUBS_H
+#define __Q11K_TRACE_STUBS_H
+
+#include "q11k_core.h"
+
+static inline void trace_q11k_raw_report(const q11k_state_t* st, const u8* data, int size) {}
+static inline void trace_q11k_pen_sample(const q11k_state_t* st, u8 type, int x, int y, int pressure) {}
+static inline void trace_q11k_key_map(const q11k_state_t* st, unsigned int scancode, unsigned int keycode) {}
+static inline void trace_q11k_relative_toggle(const q11k_state_t* st, bool enabled) {}
+static inline void trace_q11k_frame(const q11k_state_t* st, int idev) {}
+static inline void trace_q11k_scroll(const q11k_state_t* st, unsigned int code, int value) {}
+static inline void trace_q11k_pen_prox(const q11k_state_t* st, int prox) {}
+
+#endif
+
+#else
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM q11k
+
+#if !defined(_Q11K_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _Q11K_TRACE_H
+
+#include <linux/tracepoint.h>
+#include "q11k_core.h"
+
+TRACE_EVENT(q11k_raw_report,
+    TP_PROTO(const q11k_state_t* st, const u8* data, int size),
+    TP_ARGS(st, data, size),
+    TP_STRUCT__entry(
+        __field(const void*, dev)
+        __field(int, size)
+        __array(u8, data, Q11K_REPORT_SIZE)
+    ),
+    TP_fast_assign(
+        __entry->dev = st;
+        __entry->size = size;
+        memset(__entry->data, 0, Q11K_REPORT_SIZE);
+        memcpy(__entry->data, data, min_t(int, size, Q11K_REPORT_SIZE));
+    ),
+    TP_printk("dev=%p size=%d data=%*phN",
+              __entry->dev, __entry->size, Q11K_REPORT_SIZE, __entry->data)
+);
+
+TRACE_EVENT(q11k_pen_sample,
+    TP_PROTO(const q11k_state_t* st, u8 type, int x, int y, int pressure),
+    TP_ARGS(st, type, x, y, pressure),
+    TP_STRUCT__entry(
+        __field(const void*, dev)
+        __field(u8, type)
+        __field(int, x)
+        __field(int, y)
+        __field(int, pressure)
+    ),
+    TP_fast_assign(
+        __entry->dev = st;
+        __entry->type = type;
+        __entry->x = x;
+        __entry->y = y;
+        __entry->pressure = pressure;
+    ),
+    TP_printk("dev=%p type=0x%02x x=%d y=%d pressure=%d",
+              __entry->dev, __entry->type, __entry->x, __entry->y, __entry->pressure)
+);
+
+/* keycode 0 is a release, KEY_UNKNOWN an unmapped scancode */
+TRACE_EVENT(q11k_key_map,
+    TP_PROTO(const q11k_state_t* st, unsigned int scancode, unsigned int keycode),
+    TP_ARGS(st, scancode, keycode),
+    TP_STRUCT__entry(
+        __field(const void*, dev)
+        __field(unsigned int, scancode)
+        __field(unsigned int, keycode)
+    ),
+    TP_fast_assign(
+        __entry->dev = st;
+        __entry->scancode = scancode;
+        __entry->keycode = keycode;
+    ),
+    TP_printk("dev=%p scancode=0x%03x keycode=%u",
+              __entry->dev, __entry->scancode, __entry->keycode)
+);
+
+TRACE_EVENT(q11k_relative_toggle,
+    TP_PROTO(const q11k_state_t* st, bool enabled),
+    TP_ARGS(st, enabled),
+    TP_STRUCT__entry(
+        __field(const void*, dev)
+        __field(bool, enabled)
+    ),
+    TP_fast_assign(
+        __entry->dev = st;
+        __entry->enabled = enabled;
+    ),
+    TP_printk("dev=%p relative=%d", __entry->dev, __entry->enabled)
+);
+
+TRACE_DEFINE_ENUM(Q11K_INPUT_PEN);
+TRACE_DEFINE_ENUM(Q11K_INPUT_KEYBOARD);
+TRACE_DEFINE_ENUM(Q11K_INPUT_SCROLL);
+
+/* An input_sync() on device @idev (enum q11k_input) */
+TRACE_EVENT(q11k_frame,
+    TP_PROTO(const q11k_state_t* st, int idev),
+    TP_ARGS(st, idev),
+    TP_STRUCT__entry(
+        __field(const void*, dev)
+        __field(int, idev)
+    ),
+    TP_fast_assign(
+        __entry->dev = st;
+        __entry->idev = idev;
+    ),
+    TP_printk("dev=%p input=%s", __entry->dev,
+              __print_symbolic(__entry->idev,
+                               { Q11K_INPUT_PEN, "pen" },
+                               { Q11K_INPUT_KEYBOARD, "keyboard" },
+                               { Q11K_INPUT_SCROLL, "scroll" }))
+);
+
+/* A notch of the strip scroll mode, @code is REL_WHEEL_HI_RES or REL_HWHEEL_HI_RES */
+TRACE_EVENT(q11k_scroll,
+    TP_PROTO(const q11k_state_t* st, unsigned int code, int value),
+    TP_ARGS(st, code, value),
+    TP_STRUCT__entry(
+        __field(const void*, dev)
+        __field(unsigned int, code)
+        __field(int, value)
+    ),
+    TP_fast_assign(
+        __entry->dev = st;
+        __entry->code = code;
+        __entry->value = value;
+    ),
+    TP_printk("dev=%p code=%u value=%d", __entry->dev, __entry->code, __entry->value)
+);
+
+TRACE_DEFINE_ENUM(Q11K_PROX_OUT);
+TRACE_DEFINE_ENUM(Q11K_PROX_IN);
+TRACE_DEFINE_ENUM(Q11K_PROX_CONTACT);
+
+/* A proximity transition of the pen (enum q11k_pen_prox) */
+TRACE_EVENT(q11k_pen_prox,
+    TP_PROTO(const q11k_state_t* st, int prox),
+    TP_ARGS(st, prox),
+    TP_STRUCT__entry(
+        __field(const void*, dev)
+        __field(int, prox)
+    ),
+    TP_fast_assign(
+        __entry->dev = st;
+        __entry->prox = prox;
+    ),
+    TP_printk("dev=%p prox=%s", __entry->dev,
+              __print_symbolic(__entry->prox,
+                               { Q11K_PROX_OUT, "out" },
+                               { Q11K_PROX_IN, "in" },
+                               { Q11K_PROX_CONTACT, "contact" }))
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE q11k_trace
+#include <trace/define_trace.h>
+
+#endif
@@ -0,0 +1,504 @@
+/*
+ * Throughput benchmark for the Q11K report decoding core.
+ *
+ * Runs synthetic report streams (one per report type) and optionally
+ * recorded streams through q11k_core_raw_event() with a counting event
+ * sink and prints ns/report and reports/sec.
+ *
+ * Hover traces (a resting or slowly moving pen with sensor jitter) are
+ * also run with the jitter deadband off and on, printing the events each
+ * emits and how far the reported position strayed from the pen.
+ *
+ * Recorded streams are text files with one report per line written as
+ * hex bytes, e.g. "08 81 a0 4e 10 2a 00 10 00 00 00 00". Everything after
+ * a '#' is ignored.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "q11k_core.h"
+
+#define STREAM_LEN      4096
+#define BENCH_REPORTS   (4 * 1024 * 1024)
+#define MAX_TYPES       256
+#define REPORT_NS       4291845     /* 233 reports/s */
+
+typedef struct __tag_bench_sink_t
+{
+    unsigned long keys;
+    unsigned long abs;
+    unsigned long msc;
+    unsigned long rel;
+    unsigned long syncs;
+    unsigned long checksum;
+    int x;
+    int y;
+} bench_sink_t;
+
+typedef struct __tag_report_stream_t
+{
+    u8 (*reports)[Q11K_REPORT_SIZE];
+    size_t count;
+    size_t alloc;
+} report_stream_t;
+
+/* 0xa0 has no handler and measures the reject path */
+static const u8 report_types[] = { 0x80, 0x81, 0x82, 0x84, 0x90, 0xe0, 0xe1, 0xa0 };
+
+static void bench_report_key(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    bench_sink_t* s = ctx;
+    s->keys++;
+    s->checksum += code ^ value;
+}
+
+static void bench_report_abs(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    bench_sink_t* s = ctx;
+    s->abs++;
+    s->checksum += code ^ value;
+    if (code == ABS_X)
+    {
+        s->x = value;
+    }
+    else if (code == ABS_Y)
+    {
+        s->y = value;
+    }
+}
+
+static void bench_report_msc(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    bench_sink_t* s = ctx;
+    s->msc++;
+    s->checksum += code ^ value;
+}
+
+static void bench_report_rel(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    bench_sink_t* s = ctx;
+    s->rel++;
+    s->checksum += code ^ value;
+}
+
+static void bench_sync(void* ctx, enum q11k_input idev, u64 time_ns)
+{
+    bench_sink_t* s = ctx;
+    s->syncs++;
+}
+
+static const struct q11k_sink_ops bench_sink_ops = {
+    .report_key = bench_report_key,
+    .report_abs = bench_report_abs,
+    .report_msc = bench_report_msc,
+    .report_rel = bench_report_rel,
+    .sync       = bench_sync,
+};
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void stream_push(report_stream_t* s, const u8* report)
+{
+    if (s->count == s->alloc)
+    {
+        s->alloc = s->alloc ? s->alloc * 2 : 256;
+        s->reports = realloc(s->reports, s->alloc * sizeof(*s->reports));
+        if (s->reports == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    memcpy(s->reports[s->count++], report, Q11K_REPORT_SIZE);
+}
+
+static void put_le16(u8* p, int v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+/* Synthetic report i of a stream of the given type */
+static void make_report(u8 type, size_t i, u8* r)
+{
+    static const u8 gestures[] = { 0x01, 0x11, 0x12, 0x13, 0x14, 0x15, 0x22, 0x23, 0x24, 0x25, 0x31 };
+    int x = 1000 + (int)(i * 7) % 48000;
+    int y = 1000 + (int)(i * 5) % 29000;
+    int pressure = 100 + (int)(i * 13) % 8000;
+
+    memset(r, 0, Q11K_REPORT_SIZE);
+    r[0] = Q11K_REPORT_ID;
+    r[1] = type;
+
+    switch (type)
+    {
+        case 0x80:
+        case 0x81:
+        case 0x82:
+        case 0x84:
+        {
+            put_le16(r + 2, x);
+            put_le16(r + 4, y);
+            put_le16(r + 6, (type == 0x80) ? 0 : pressure);
+            break;
+        }
+        case 0x90:
+        {
+            put_le16(r + 2, x);
+            put_le16(r + 4, y);
+            break;
+        }
+        case 0xe0:
+        {
+            /* press and release every pad key in turn */
+            r[4] = (i & 1) ? 0x00 : (u8)(1 << ((i / 2) % 8));
+            break;
+        }
+        case 0xe1:
+        {
+            r[4] = (i & 1) ? 0x00 : gestures[(i / 2) % sizeof(gestures)];
+            break;
+        }
+    }
+}
+
+/* Hover traces, see make_trace() */
+enum bench_trace
+{
+    TRACE_HOVER = 0,        /* pen held still above the surface */
+    TRACE_REST,             /* pen held still on the surface */
+    TRACE_HOVER_MOVES,      /* hovering, moving every now and then */
+    TRACE_SLOW_STROKE,      /* drawing slowly */
+    TRACE_COUNT
+};
+
+static const char* const trace_names[TRACE_COUNT] = {
+    "hover", "rest", "hover-moves", "slow-stroke"
+};
+
+static u32 trace_seed = 1;
+
+/* Sensor noise, uniform in [-amp, amp] */
+static int trace_noise(int amp)
+{
+    trace_seed = trace_seed * 1103515245 + 12345;
+    return (int)((trace_seed >> 16) % (2 * amp + 1)) - amp;
+}
+
+static void make_trace(enum bench_trace kind, report_stream_t* s)
+{
+    u8 r[Q11K_REPORT_SIZE];
+    size_t i;
+
+    trace_seed = 1;
+    for (i = 0; i < STREAM_LEN; i++)
+    {
+        int x = 25000, y = 15000, pressure = 0;
+        u8 type = 0x80;
+
+        switch (kind)
+        {
+            case TRACE_HOVER:
+                x += trace_noise(3);
+                y += trace_noise(3);
+                break;
+            case TRACE_REST:
+                type = 0x81;
+                x += trace_noise(1);
+                y += trace_noise(1);
+                pressure = 3000 + trace_noise(3);
+                break;
+            case TRACE_HOVER_MOVES:
+            {
+                /* rest for 160 reports, then move 12 counts a report for 96 */
+                size_t pos = i % 256;
+                x += (int)(i / 256) * 96 * 12 % 20000 + ((pos < 160) ? 0 : (int)(pos - 160) * 12);
+                x += trace_noise(3);
+                y += trace_noise(3);
+                break;
+            }
+            case TRACE_SLOW_STROKE:
+                type = 0x81;
+                x += (int)i * 2 + trace_noise(1);
+                y += trace_noise(1);
+                pressure = 2000 + (int)i % 2000;
+                break;
+            default:
+                break;
+        }
+
+        memset(r, 0, Q11K_REPORT_SIZE);
+        r[0] = Q11K_REPORT_ID;
+        r[1] = type;
+        put_le16(r + 2, x);
+        put_le16(r + 4, y);
+        put_le16(r + 6, pressure);
+        stream_push(s, r);
+    }
+}
+
+static void make_stream(u8 type, report_stream_t* s)
+{
+    u8 r[Q11K_REPORT_SIZE];
+    size_t i;
+
+    for (i = 0; i < STREAM_LEN; i++)
+    {
+        make_report(type, i, r);
+        stream_push(s, r);
+    }
+}
+
+static int load_stream(const char* path, report_stream_t* s)
+{
+    char line[512];
+    FILE* f = fopen(path, "r");
+
+    if (f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        u8 r[Q11K_REPORT_SIZE];
+        int n = 0;
+        char* p = line;
+        char* hash = strchr(line, '#');
+
+        if (hash != NULL)
+        {
+            *hash = '\0';
+        }
+
+        while (n < Q11K_REPORT_SIZE)
+        {
+            char* end;
+            unsigned long v;
+
+            while (*p != '\0' && !isxdigit((unsigned char)*p))
+            {
+                p++;
+            }
+            if (*p == '\0')
+            {
+                break;
+            }
+            v = strtoul(p, &end, 16);
+            r[n++] = (u8)v;
+            p = end;
+        }
+
+        if (n == Q11K_REPORT_SIZE)
+        {
+            stream_push(s, r);
+        }
+        else if (n != 0)
+        {
+            fprintf(stderr, "%s: skipping short report (%d bytes)\n", path, n);
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/* Optional pen processing for run_stream() */
+#define BENCH_FILTER        0x01    /* 1-euro filter with prediction */
+#define BENCH_CURVE         0x02    /* Bezier pressure curve */
+#define BENCH_SCROLL        0x04    /* strip gestures in scroll mode */
+#define BENCH_NO_DEADBAND   0x08    /* jitter deadband off */
+
+static void run_stream(const char* name, const report_stream_t* s, unsigned int opts)
+{
+    static q11k_pressure_lut_t lut;
+    static const u32 soft[4] = { 0, 50, 50, 100 };
+    q11k_state_t st;
+    bench_sink_t sink;
+    size_t total, i;
+    u64 t0, t1, t_report = 0;
+    double ns;
+
+    if (s->count == 0)
+    {
+        return;
+    }
+
+    memset(&sink, 0, sizeof(sink));
+    q11k_core_init(&st, &bench_sink_ops, &sink);
+    if (opts & BENCH_FILTER)
+    {
+        st.default_config.filter.enabled = 1;
+        st.default_config.filter.predict_us = 4000;
+    }
+    if (opts & BENCH_CURVE)
+    {
+        q11k_pressure_lut_bezier(&lut, soft);
+        st.default_config.pressure = &lut;
+    }
+    if (opts & BENCH_SCROLL)
+    {
+        st.default_config.scroll.enabled = 1;
+    }
+    if (opts & BENCH_NO_DEADBAND)
+    {
+        st.default_config.deadband.enabled = 0;
+    }
+
+    /* warm up caches and branch predictors */
+    for (i = 0; i < s->count; i++)
+    {
+        q11k_core_raw_event(&st, s->reports[i], Q11K_REPORT_SIZE, t_report += REPORT_NS);
+    }
+
+    memset(&sink, 0, sizeof(sink));
+    total = (BENCH_REPORTS / s->count + 1) * s->count;
+
+    t0 = now_ns();
+    for (i = 0; i < total; i++)
+    {
+        q11k_core_raw_event(&st, s->reports[i % s->count], Q11K_REPORT_SIZE, t_report += REPORT_NS);
+    }
+    t1 = now_ns();
+
+    ns = (double)(t1 - t0) / total;
+    printf("%-12s %10zu %10.2f %14.0f %8.2f %8.2f\n",
+           name, total, ns, 1e9 / ns,
+           (double)(sink.keys + sink.abs + sink.msc + sink.rel) / total,
+           (double)sink.syncs / total);
+}
+
+/*
+ * One pass over a trace: events emitted, and the largest distance between
+ * the reported position and the pen's
+ */
+static unsigned long trace_events(const report_stream_t* s, bool deadband, int* max_error)
+{
+    q11k_state_t st;
+    bench_sink_t sink;
+    u64 t_report = 0;
+    size_t i;
+
+    memset(&sink, 0, sizeof(sink));
+    q11k_core_init(&st, &bench_sink_ops, &sink);
+    st.default_config.deadband.enabled = deadband;
+    *max_error = 0;
+
+    for (i = 0; i < s->count; i++)
+    {
+        int dx, dy;
+
+        q11k_core_raw_event(&st, s->reports[i], Q11K_REPORT_SIZE, t_report += REPORT_NS);
+        dx = abs(sink.x - q11k_decode_le16(s->reports[i], Q11K_REPORT_X));
+        dy = abs(sink.y - q11k_decode_le16(s->reports[i], Q11K_REPORT_Y));
+        *max_error = (dx > *max_error) ? dx : *max_error;
+        *max_error = (dy > *max_error) ? dy : *max_error;
+    }
+
+    return sink.keys + sink.abs + sink.msc + sink.rel + sink.syncs;
+}
+
+static void run_traces(void)
+{
+    int t;
+
+    printf("\n%-12s %10s %10s %10s %8s %10s\n",
+           "trace", "reports", "events", "deadband", "saved", "max error");
+
+    for (t = 0; t < TRACE_COUNT; t++)
+    {
+        report_stream_t s = { NULL, 0, 0 };
+        unsigned long off, on;
+        int err_off, err_on;
+
+        make_trace(t, &s);
+        off = trace_events(&s, false, &err_off);
+        on = trace_events(&s, true, &err_on);
+        printf("%-12s %10zu %10lu %10lu %7.1f%% %10d\n",
+               trace_names[t], s.count, off, on, 100.0 * (off - on) / off, err_on);
+        free(s.reports);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t t;
+    int i;
+
+    printf("%-12s %10s %10s %14s %8s %8s\n",
+           "stream", "reports", "ns/report", "reports/sec", "ev/rep", "syn/rep");
+
+    for (t = 0; t < sizeof(report_types); t++)
+    {
+        report_stream_t s = { NULL, 0, 0 };
+        char name[32];
+
+        make_stream(report_types[t], &s);
+        snprintf(name, sizeof(name), "synth-0x%02x", report_types[t]);
+        run_stream(name, &s, 0);
+        if (report_types[t] == 0x81)
+        {
+            run_stream("filter-0x81", &s, BENCH_FILTER);
+            run_stream("curve-0x81", &s, BENCH_CURVE);
+            run_stream("nodb-0x81", &s, BENCH_NO_DEADBAND);
+        }
+        if (report_types[t] == 0xe1)
+        {
+            run_stream("scroll-0xe1", &s, BENCH_SCROLL);
+        }
+        free(s.reports);
+    }
+
+    for (t = 0; t < TRACE_COUNT; t++)
+    {
+        report_stream_t s = { NULL, 0, 0 };
+
+        make_trace(t, &s);
+        run_stream(trace_names[t], &s, 0);
+        free(s.reports);
+    }
+
+    run_traces();
+
+    for (i = 1; i < argc; i++)
+    {
+        report_stream_t all = { NULL, 0, 0 };
+        report_stream_t by_type[MAX_TYPES];
+        size_t r;
+
+        if (load_stream(argv[i], &all) != 0)
+        {
+            return 1;
+        }
+
+        printf("# %s: %zu reports\n", argv[i], all.count);
+        run_stream("recorded", &all, 0);
+
+        memset(by_type, 0, sizeof(by_type));
+        for (r = 0; r < all.count; r++)
+        {
+            stream_push(&by_type[all.reports[r][1]], all.reports[r]);
+        }
+        for (t = 0; t < MAX_TYPES; t++)
+        {
+            char name[32];
+
+            snprintf(name, sizeof(name), "rec-0x%02zx", t);
+            run_stream(name, &by_type[t], 0);
+            free(by_type[t].reports);
+        }
+        free(all.reports);
+    }
+
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * Boundary tests of the report field decoding.
+ *
+ * Checks q11k_decode_le16() against every 16 bit value, and runs pen and
+ * mouse reports carrying the boundary values of each field through
+ * q11k_core_raw_event(), expecting what comes out to lie in the ranges
+ * q11k_register_pen() advertises with input_set_abs_params(). Reports
+ * that are not decoded, or arrive on the wrong interface, must land in
+ * the right drop counter, and the 0xc0 leave report must release the
+ * pen. Exits non-zero on the first failed check of each group.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "q11k_core.h"
+
+/* What the pen device advertises, see q11k_register_pen() */
+typedef struct __tag_abs_range_t
+{
+    const char* name;
+    unsigned int code;
+    int offset;
+    int min;
+    int max;
+} abs_range_t;
+
+static const abs_range_t abs_ranges[] = {
+    { "ABS_X",        ABS_X,        Q11K_REPORT_X,        0, MAX_ABS_X },
+    { "ABS_Y",        ABS_Y,        Q11K_REPORT_Y,        0, MAX_ABS_Y },
+    { "ABS_PRESSURE", ABS_PRESSURE, Q11K_REPORT_PRESSURE, 0, MAX_ABS_PRESSURE },
+};
+
+typedef struct __tag_test_sink_t
+{
+    int abs[ABS_CNT];
+    int key[KEY_CNT];
+    int key_events;
+} test_sink_t;
+
+static unsigned long checks = 0;
+static unsigned long failures = 0;
+
+static void test_report_key(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    test_sink_t* s = ctx;
+
+    if (idev == Q11K_INPUT_PEN && code < KEY_CNT)
+    {
+        s->key[code] = value;
+        s->key_events++;
+    }
+}
+
+static void test_report_abs(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    test_sink_t* s = ctx;
+
+    if (idev == Q11K_INPUT_PEN && code < ABS_CNT)
+    {
+        s->abs[code] = value;
+    }
+}
+
+static void test_report_msc(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+}
+
+static void test_report_rel(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+}
+
+static void test_sync(void* ctx, enum q11k_input idev, u64 time_ns)
+{
+}
+
+static const struct q11k_sink_ops test_sink_ops = {
+    .report_key = test_report_key,
+    .report_abs = test_report_abs,
+    .report_msc = test_report_msc,
+    .report_rel = test_report_rel,
+    .sync       = test_sync,
+};
+
+static bool check(bool ok, const char* what, int value, int got, int expect)
+{
+    checks++;
+    if (!ok)
+    {
+        failures++;
+        printf("FAIL %s: raw %d gave %d, expected %d\n", what, value, got, expect);
+    }
+    return ok;
+}
+
+static void put_le16(u8* data, int offset, int value)
+{
+    data[offset] = value & 0xff;
+    data[offset + 1] = value >> 8;
+}
+
+/* Every 16 bit value decodes to itself, and clamped fields stay monotonic */
+static void test_decode_le16(void)
+{
+    u8 data[Q11K_REPORT_SIZE];
+    int v, i;
+
+    memset(data, 0, sizeof(data));
+    for (v = 0; v <= 0xffff; v++)
+    {
+        put_le16(data, Q11K_REPORT_X, v);
+        if (!check(q11k_decode_le16(data, Q11K_REPORT_X) == v, "le16", v,
+                   q11k_decode_le16(data, Q11K_REPORT_X), v))
+        {
+            break;
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(abs_ranges); i++)
+    {
+        const abs_range_t* r = &abs_ranges[i];
+        int last = -1;
+
+        for (v = 0; v <= 0xffff; v++)
+        {
+            int expect = (v > r->max) ? r->max : v;
+            int got;
+
+            put_le16(data, r->offset, v);
+            got = q11k_decode_field(data, r->offset, r->max);
+            if (!check(got == expect && got >= last, r->name, v, got, expect))
+            {
+                break;
+            }
+            last = got;
+        }
+    }
+}
+
+/*
+ * One report with @value in the field of @r, the others mid-range, from
+ * a fresh state so that every value is a change
+ */
+static void test_report(u8 type, const abs_range_t* r, int value)
+{
+    q11k_state_t st;
+    test_sink_t sink;
+    u8 data[Q11K_REPORT_SIZE];
+    int expect = (value > r->max) ? r->max : value;
+    int got;
+
+    memset(&sink, 0, sizeof(sink));
+    q11k_core_init(&st, &test_sink_ops, &sink);
+    st.default_config.deadband.enabled = 0;
+
+    memset(data, 0, sizeof(data));
+    data[0] = Q11K_REPORT_ID;
+    data[1] = type;
+    put_le16(data, Q11K_REPORT_X, MAX_ABS_X / 2);
+    put_le16(data, Q11K_REPORT_Y, MAX_ABS_Y / 2);
+    put_le16(data, Q11K_REPORT_PRESSURE, MAX_ABS_PRESSURE / 2);
+    put_le16(data, r->offset, value);
+
+    q11k_core_raw_event(&st, data, sizeof(data), 1000000);
+    got = sink.abs[r->code];
+
+    check(got >= r->min && got <= r->max && got == expect, r->name, value, got, expect);
+}
+
+static void test_boundaries(void)
+{
+    int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(abs_ranges); i++)
+    {
+        const abs_range_t* r = &abs_ranges[i];
+        const int values[] = {
+            0, 1, 0xff, 0x100, 0x101, 0x1ff, 0x200,
+            r->max - 1, r->max, r->max + 1, 0x7fff, 0x8000, 0xfeff, 0xff00, 0xffff
+        };
+
+        for (j = 0; j < ARRAY_SIZE(values); j++)
+        {
+            test_report(0x81, r, values[j]);
+
+            /* mouse reports carry no pressure */
+            if (r->code != ABS_PRESSURE)
+            {
+                test_report(0x90, r, values[j]);
+            }
+        }
+    }
+}
+
+/* Each foreign report ID is counted on its own, short reports as truncated */
+static void test_dropped(void)
+{
+    q11k_state_t st;
+    test_sink_t sink;
+    u8 data[Q11K_REPORT_SIZE];
+    int id;
+
+    memset(&sink, 0, sizeof(sink));
+    q11k_core_init(&st, &test_sink_ops, &sink);
+
+    memset(data, 0, sizeof(data));
+    for (id = 0; id < Q11K_REPORT_IDS; id++)
+    {
+        data[0] = id;
+        data[1] = 0x81;
+        q11k_core_raw_event(&st, data, sizeof(data), 1000000);
+    }
+    data[0] = 0x01;
+    q11k_core_raw_event(&st, data, sizeof(data), 1000000);
+
+    for (id = 0; id < Q11K_REPORT_IDS; id++)
+    {
+        int expect = (id == Q11K_REPORT_ID) ? 0 : (id == 0x01) ? 2 : 1;
+        int got = atomic_read(&st.stats.foreign[id]);
+
+        check(got == expect, "foreign", id, got, expect);
+    }
+
+    data[0] = Q11K_REPORT_ID;
+    q11k_core_raw_event(&st, data, 0, 1000000);
+    q11k_core_raw_event(&st, data, 1, 1000000);
+    q11k_core_raw_event(&st, data, Q11K_REPORT_HEADER_SIZE, 1000000);
+    check(atomic_read(&st.stats.truncated) == 3, "truncated", 3,
+          atomic_read(&st.stats.truncated), 3);
+}
+
+/* Pen and mouse reports only count on the pen interface, keys on the pad */
+static void test_misrouted(void)
+{
+    static const u8 pen_types[] = { 0x80, 0x81, 0x82, 0x84, 0x90, 0xc0 };
+    static const u8 pad_types[] = { 0xe0, 0xe1 };
+    q11k_state_t st;
+    test_sink_t sink;
+    u8 data[Q11K_REPORT_SIZE];
+    int i;
+
+    memset(&sink, 0, sizeof(sink));
+    q11k_core_init(&st, &test_sink_ops, &sink);
+
+    memset(data, 0, sizeof(data));
+    data[0] = Q11K_REPORT_ID;
+    for (i = 0; i < ARRAY_SIZE(pen_types); i++)
+    {
+        data[1] = pen_types[i];
+        check(!q11k_core_iface_event(&st, Q11K_IFACE_PAD, data, sizeof(data), 1000000),
+              "pen report on pad", pen_types[i], 1, 0);
+        check(q11k_core_iface_event(&st, Q11K_IFACE_PEN, data, sizeof(data), 1000000),
+              "pen report on pen", pen_types[i], 0, 1);
+    }
+    for (i = 0; i < ARRAY_SIZE(pad_types); i++)
+    {
+        data[1] = pad_types[i];
+        check(!q11k_core_iface_event(&st, Q11K_IFACE_PEN, data, sizeof(data), 1000000),
+              "pad report on pen", pad_types[i], 1, 0);
+        check(q11k_core_iface_event(&st, Q11K_IFACE_PAD, data, sizeof(data), 1000000),
+              "pad report on pad", pad_types[i], 0, 1);
+    }
+
+    check(atomic_read(&st.stats.misrouted) == ARRAY_SIZE(pen_types) + ARRAY_SIZE(pad_types),
+          "misrouted", 0, atomic_read(&st.stats.misrouted), ARRAY_SIZE(pen_types) + ARRAY_SIZE(pad_types));
+}
+
+/* 0xc0 takes a pen in contact with a button held out of range, once */
+static void test_pen_leave(void)
+{
+    static const int released[] = { BTN_TOOL_PEN, BTN_TOUCH, BTN_STYLUS };
+    q11k_state_t st;
+    test_sink_t sink;
+    u8 data[Q11K_REPORT_SIZE];
+    int i;
+
+    memset(&sink, 0, sizeof(sink));
+    q11k_core_init(&st, &test_sink_ops, &sink);
+    st.default_config.deadband.enabled = 0;
+
+    memset(data, 0, sizeof(data));
+    data[0] = Q11K_REPORT_ID;
+    data[1] = 0x81;
+    put_le16(data, Q11K_REPORT_X, MAX_ABS_X / 2);
+    put_le16(data, Q11K_REPORT_Y, MAX_ABS_Y / 2);
+    put_le16(data, Q11K_REPORT_PRESSURE, MAX_ABS_PRESSURE / 2);
+    q11k_core_raw_event(&st, data, sizeof(data), 1000000);
+    data[1] = 0x82;
+    q11k_core_raw_event(&st, data, sizeof(data), 2000000);
+    check(sink.key[BTN_TOUCH] == 1 && sink.key[BTN_STYLUS] == 1, "before leave", 0x82,
+          sink.key[BTN_TOUCH] + sink.key[BTN_STYLUS], 2);
+
+    data[1] = 0xc0;
+    q11k_core_raw_event(&st, data, Q11K_REPORT_HEADER_SIZE, 3000000);
+    for (i = 0; i < ARRAY_SIZE(released); i++)
+    {
+        check(sink.key[released[i]] == 0, "leave releases", released[i], sink.key[released[i]], 0);
+    }
+    check(sink.abs[ABS_PRESSURE] == 0, "leave pressure", 0xc0, sink.abs[ABS_PRESSURE], 0);
+
+    /* a second leave has nothing left to release */
+    sink.key_events = 0;
+    q11k_core_raw_event(&st, data, Q11K_REPORT_HEADER_SIZE, 4000000);
+    check(sink.key_events == 0, "second leave", 0xc0, sink.key_events, 0);
+}
+
+int main(void)
+{
+    test_decode_le16();
+    test_boundaries();
+    test_dropped();
+    test_misrouted();
+    test_pen_leave();
+
+    printf("q11k_decode_test: %lu checks, %lu failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
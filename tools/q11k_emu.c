@@ -0,0 +1,549 @@
+/*
+ * Virtual Huion Q11K: creates both HID interfaces through /dev/uhid and
+ * plays scripted strokes, hovers, stylus button presses, pad keys and
+ * touch-strip gestures at a fixed report rate.
+ *
+ * Every injected report is appended to a shared injection log (see
+ * q11k_emu_log.h) so q11k_latency can measure injection to event latency.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "q11k_uhid.h"
+#include "q11k_emu_log.h"
+
+#define DEFAULT_RATE        200
+#define WAIT_OPEN_MS        30000
+#define LINGER_MS           1000
+
+typedef struct __tag_script_t
+{
+    u8 (*reports)[Q11K_REPORT_SIZE];
+    size_t count;
+    size_t alloc;
+
+    /* position generator */
+    unsigned long phase;
+    int last_x;
+    int last_y;
+} script_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    stop_requested = 1;
+}
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until(u64 t_ns, bool busy)
+{
+    struct timespec ts;
+
+    if (busy)
+    {
+        while (now_ns() < t_ns)
+        {
+        }
+        return;
+    }
+
+    ts.tv_sec = t_ns / 1000000000ull;
+    ts.tv_nsec = t_ns % 1000000000ull;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !stop_requested)
+    {
+    }
+}
+
+static void script_push(script_t* s, const u8* report)
+{
+    if (s->count == s->alloc)
+    {
+        s->alloc = s->alloc ? s->alloc * 2 : 256;
+        s->reports = realloc(s->reports, s->alloc * sizeof(*s->reports));
+        if (s->reports == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    memcpy(s->reports[s->count++], report, Q11K_REPORT_SIZE);
+}
+
+/*
+ * Pen sample on a Lissajous path. Consecutive samples always differ in
+ * position so that every report yields its own evdev frame, which is what
+ * q11k_latency relies on to match frames to injections.
+ */
+static void script_pen(script_t* s, u8 type, int pressure)
+{
+    u8 r[Q11K_REPORT_SIZE];
+    int x = 25400 + (int)(20000 * sin(s->phase * 0.0100));
+    int y = 15875 + (int)(12000 * sin(s->phase * 0.0137));
+
+    s->phase++;
+    if (x == s->last_x && y == s->last_y)
+    {
+        x++;
+    }
+    s->last_x = x;
+    s->last_y = y;
+
+    memset(r, 0, sizeof(r));
+    r[0] = Q11K_REPORT_ID;
+    r[1] = type;
+    r[2] = x & 0xff;
+    r[3] = x >> 8;
+    r[4] = y & 0xff;
+    r[5] = y >> 8;
+    r[6] = pressure & 0xff;
+    r[7] = pressure >> 8;
+    script_push(s, r);
+}
+
+/* The pen leaving range, sent once by the tablet after its last sample */
+static void script_pen_leave(script_t* s)
+{
+    u8 r[Q11K_REPORT_SIZE];
+
+    memset(r, 0, sizeof(r));
+    r[0] = Q11K_REPORT_ID;
+    r[1] = 0xc0;
+    script_push(s, r);
+}
+
+static void script_pad(script_t* s, u8 type, u8 code)
+{
+    u8 r[Q11K_REPORT_SIZE];
+
+    memset(r, 0, sizeof(r));
+    r[0] = Q11K_REPORT_ID;
+    r[1] = type;
+    r[4] = code;
+    script_push(s, r);
+}
+
+static void scenario_stroke(script_t* s)
+{
+    int i;
+
+    for (i = 0; i < 10; i++)
+    {
+        script_pen(s, 0x80, 0);
+    }
+    for (i = 0; i < 120; i++)
+    {
+        /* pressure ramps up and back down over the stroke */
+        int p = 200 + (int)(7000 * sin(M_PI * i / 120));
+        script_pen(s, 0x81, p);
+    }
+    for (i = 0; i < 10; i++)
+    {
+        script_pen(s, 0x80, 0);
+    }
+    script_pen_leave(s);
+}
+
+static void scenario_hover(script_t* s)
+{
+    int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        script_pen(s, 0x80, 0);
+    }
+    script_pen_leave(s);
+}
+
+static void scenario_buttons(script_t* s)
+{
+    int i;
+
+    for (i = 0; i < 20; i++)
+    {
+        script_pen(s, 0x82, 0);
+    }
+    for (i = 0; i < 5; i++)
+    {
+        script_pen(s, 0x80, 0);
+    }
+    for (i = 0; i < 20; i++)
+    {
+        script_pen(s, 0x84, 0);
+    }
+    for (i = 0; i < 5; i++)
+    {
+        script_pen(s, 0x80, 0);
+    }
+    script_pen_leave(s);
+}
+
+static void scenario_keys(script_t* s)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        script_pad(s, 0xe0, 1 << i);
+        script_pad(s, 0xe0, 0x00);
+    }
+}
+
+static void scenario_strip(script_t* s)
+{
+    static const u8 gestures[] = { 0x14, 0x15, 0x22, 0x23, 0x12, 0x13, 0x24, 0x25, 0x01, 0x11, 0x31 };
+    size_t i;
+
+    for (i = 0; i < sizeof(gestures); i++)
+    {
+        script_pad(s, 0xe1, gestures[i]);
+        script_pad(s, 0xe1, 0x00);
+    }
+}
+
+static const struct
+{
+    const char* name;
+    void (*build)(script_t* s);
+} scenarios[] = {
+    { "stroke",  scenario_stroke },
+    { "hover",   scenario_hover },
+    { "buttons", scenario_buttons },
+    { "keys",    scenario_keys },
+    { "strip",   scenario_strip },
+};
+
+static int build_scenarios(script_t* s, const char* list)
+{
+    char* copy = strdup(list);
+    char* save = NULL;
+    char* tok;
+
+    for (tok = strtok_r(copy, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save))
+    {
+        size_t i;
+
+        for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+        {
+            if (strcmp(tok, scenarios[i].name) == 0)
+            {
+                scenarios[i].build(s);
+                break;
+            }
+        }
+        if (i == sizeof(scenarios) / sizeof(scenarios[0]))
+        {
+            fprintf(stderr, "unknown scenario '%s'\n", tok);
+            free(copy);
+            return -1;
+        }
+    }
+
+    free(copy);
+    return 0;
+}
+
+/* Same hex-dump format as q11k_bench: one 12 byte report per line */
+static int load_script(script_t* s, const char* path)
+{
+    char line[512];
+    FILE* f = fopen(path, "r");
+
+    if (f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        u8 r[Q11K_REPORT_SIZE];
+        char* p = line;
+        char* hash = strchr(line, '#');
+        int n = 0;
+
+        if (hash != NULL)
+        {
+            *hash = '\0';
+        }
+
+        while (n < Q11K_REPORT_SIZE)
+        {
+            char* end;
+
+            while (*p != '\0' && !isxdigit((unsigned char)*p))
+            {
+                p++;
+            }
+            if (*p == '\0')
+            {
+                break;
+            }
+            r[n++] = (u8)strtoul(p, &end, 16);
+            p = end;
+        }
+
+        if (n == Q11K_REPORT_SIZE)
+        {
+            script_push(s, r);
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/*
+ * -w: play nothing, log when the driver starts and stops I/O on each
+ * interface (UHID_OPEN / UHID_CLOSE) until interrupted. The driver only
+ * opens an interface while one of its evdev nodes is open.
+ */
+static int watch_open(q11k_uhid_t* u, const char* tag)
+{
+    static const char* const names[Q11K_UHID_IFACES] = { "pad", "pen" };
+    bool was_open[Q11K_UHID_IFACES] = { false, false };
+    u64 since[Q11K_UHID_IFACES] = { 0, 0 };
+    u64 total[Q11K_UHID_IFACES] = { 0, 0 };
+    unsigned long opens[Q11K_UHID_IFACES] = { 0, 0 };
+    u64 start = now_ns(), t;
+    int i;
+
+    fprintf(stderr, "%s: watching I/O state, ^C to stop\n", tag);
+
+    while (!stop_requested)
+    {
+        if (q11k_uhid_dispatch(u, 200) < 0)
+        {
+            return 1;
+        }
+
+        t = now_ns();
+        for (i = 0; i < Q11K_UHID_IFACES; i++)
+        {
+            if (u->opened[i] == was_open[i])
+            {
+                continue;
+            }
+            was_open[i] = u->opened[i];
+            if (was_open[i])
+            {
+                since[i] = t;
+                opens[i]++;
+            }
+            else
+            {
+                total[i] += t - since[i];
+            }
+            printf("%10.3f s  input%d (%s) I/O %s\n", (t - start) / 1e9, i, names[i],
+                   was_open[i] ? "started" : "stopped");
+            fflush(stdout);
+        }
+    }
+
+    t = now_ns();
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        if (was_open[i])
+        {
+            total[i] += t - since[i];
+        }
+        printf("input%d (%s): opened %lu times, I/O running %.3f of %.3f s\n",
+               i, names[i], opens[i], total[i] / 1e9, (t - start) / 1e9);
+    }
+
+    return 0;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -r HZ       report rate (default %d)\n"
+        "  -n COUNT    number of reports to play (default: one pass of the script)\n"
+        "  -t SEC      play for SEC seconds, looping the script\n"
+        "  -s LIST     comma separated scenarios: stroke,hover,buttons,keys,strip\n"
+        "              (default: all)\n"
+        "  -f FILE     play reports from a hex-dump file instead of scenarios\n"
+        "  -l PATH     injection log for q11k_latency (default %s)\n"
+        "  -L          do not write an injection log\n"
+        "  -T TAG      phys/uniq prefix of the virtual tablet (default q11k-emu-PID)\n"
+        "  -b          busy-wait between reports for accurate pacing at kHz rates\n"
+        "  -k          keep the device after playback until interrupted\n"
+        "  -w          play nothing, log driver I/O start/stop per interface\n"
+        "  -v          print uhid events\n",
+        prog, DEFAULT_RATE, Q11K_EMU_LOG_DEFAULT);
+}
+
+int main(int argc, char** argv)
+{
+    script_t script;
+    q11k_uhid_t uhid;
+    q11k_emu_log_t* log = NULL;
+    const char* scenario_list = "stroke,hover,buttons,keys,strip";
+    const char* script_file = NULL;
+    const char* log_path = Q11K_EMU_LOG_DEFAULT;
+    char tag[64];
+    double rate = DEFAULT_RATE;
+    double seconds = 0;
+    unsigned long count = 0;
+    unsigned long i, late = 0;
+    bool busy = false, keep = false, use_log = true, watch = false;
+    u64 period, next, start, end;
+    int opt, rc;
+
+    memset(&script, 0, sizeof(script));
+    memset(&uhid, 0, sizeof(uhid));
+    script.last_x = -1;
+    script.last_y = -1;
+    snprintf(tag, sizeof(tag), "q11k-emu-%d", (int)getpid());
+
+    while ((opt = getopt(argc, argv, "r:n:t:s:f:l:LT:bkwvh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': rate = atof(optarg); break;
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 't': seconds = atof(optarg); break;
+            case 's': scenario_list = optarg; break;
+            case 'f': script_file = optarg; break;
+            case 'l': log_path = optarg; break;
+            case 'L': use_log = false; break;
+            case 'T': snprintf(tag, sizeof(tag), "%s", optarg); break;
+            case 'b': busy = true; break;
+            case 'k': keep = true; break;
+            case 'w': watch = true; use_log = false; break;
+            case 'v': uhid.verbose = true; break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (rate <= 0)
+    {
+        fprintf(stderr, "invalid rate\n");
+        return 2;
+    }
+
+    rc = script_file ? load_script(&script, script_file) : build_scenarios(&script, scenario_list);
+    if (rc != 0 || script.count == 0)
+    {
+        fprintf(stderr, "empty script\n");
+        return 2;
+    }
+
+    if (seconds > 0)
+    {
+        count = (unsigned long)(seconds * rate);
+    }
+    if (count == 0)
+    {
+        count = script.count;
+    }
+
+    if (use_log)
+    {
+        log = q11k_emu_log_create(log_path, count);
+        if (log == NULL)
+        {
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    rc = q11k_uhid_create(&uhid, tag);
+    if (rc < 0)
+    {
+        fprintf(stderr, "cannot create uhid device: %s\n", strerror(-rc));
+        return 1;
+    }
+
+    if (watch)
+    {
+        rc = watch_open(&uhid, tag);
+        q11k_uhid_destroy(&uhid);
+        free(script.reports);
+        return rc;
+    }
+
+    /* the driver only starts I/O once both evdev nodes have a reader */
+    fprintf(stderr, "%s: waiting for a reader (e.g. q11k_latency) to open the input devices\n", tag);
+    rc = q11k_uhid_wait_open(&uhid, WAIT_OPEN_MS);
+    if (rc < 0)
+    {
+        fprintf(stderr, "%s: device was not opened, is q11k_device loaded and its input read?\n", tag);
+        q11k_uhid_destroy(&uhid);
+        return 1;
+    }
+
+    period = (u64)(1e9 / rate);
+    start = next = now_ns();
+
+    for (i = 0; i < count && !stop_requested; i++)
+    {
+        const u8* r = script.reports[i % script.count];
+        u64 t;
+
+        sleep_until(next, busy);
+
+        t = now_ns();
+        if (t > next + period)
+        {
+            late++;
+        }
+        if (q11k_uhid_send(&uhid, r) < 0)
+        {
+            perror("uhid write");
+            break;
+        }
+        if (log != NULL)
+        {
+            q11k_emu_log_append(log, t, r);
+        }
+
+        next += period;
+
+        if ((i & 0x3f) == 0)
+        {
+            q11k_uhid_dispatch(&uhid, 0);
+        }
+    }
+    end = now_ns();
+
+    if (log != NULL)
+    {
+        q11k_emu_log_finish(log);
+    }
+
+    fprintf(stderr, "%s: played %lu reports in %.3f s (%.1f reports/s, %lu late)\n",
+            tag, i, (end - start) / 1e9, i * 1e9 / (end - start), late);
+
+    /* let readers drain their evdev buffers before the nodes go away */
+    q11k_uhid_dispatch(&uhid, LINGER_MS);
+    while (keep && !stop_requested)
+    {
+        q11k_uhid_dispatch(&uhid, 500);
+    }
+
+    q11k_uhid_destroy(&uhid);
+    q11k_emu_log_close(log);
+    free(script.reports);
+
+    return 0;
+}
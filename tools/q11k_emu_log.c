@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "q11k_emu_log.h"
+
+static size_t q11k_emu_log_size(u64 capacity)
+{
+    return sizeof(q11k_emu_log_t) + capacity * sizeof(struct q11k_emu_log_entry);
+}
+
+q11k_emu_log_t* q11k_emu_log_create(const char* path, u64 capacity)
+{
+    size_t size = q11k_emu_log_size(capacity);
+    q11k_emu_log_t* log;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    if (ftruncate(fd, size) != 0)
+    {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+
+    log = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (log == MAP_FAILED)
+    {
+        perror("mmap");
+        return NULL;
+    }
+
+    log->capacity = capacity;
+    log->count = 0;
+    log->done = 0;
+    __atomic_store_n(&log->magic, Q11K_EMU_LOG_MAGIC, __ATOMIC_RELEASE);
+
+    return log;
+}
+
+q11k_emu_log_t* q11k_emu_log_open(const char* path)
+{
+    struct stat sb;
+    q11k_emu_log_t* log;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(q11k_emu_log_t))
+    {
+        fprintf(stderr, "%s: not an injection log\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    log = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (log == MAP_FAILED)
+    {
+        perror("mmap");
+        return NULL;
+    }
+
+    if (log->magic != Q11K_EMU_LOG_MAGIC || q11k_emu_log_size(log->capacity) > (size_t)sb.st_size)
+    {
+        fprintf(stderr, "%s: not an injection log\n", path);
+        munmap(log, sb.st_size);
+        return NULL;
+    }
+
+    return log;
+}
+
+void q11k_emu_log_close(q11k_emu_log_t* log)
+{
+    if (log != NULL)
+    {
+        munmap(log, q11k_emu_log_size(log->capacity));
+    }
+}
+
+void q11k_emu_log_append(q11k_emu_log_t* log, u64 t_ns, const u8* report)
+{
+    u64 n = log->count;
+    struct q11k_emu_log_entry* e;
+
+    if (n >= log->capacity)
+    {
+        return;
+    }
+
+    e = &log->e[n];
+    e->t_ns = t_ns;
+    e->seq = (u32)n;
+    memcpy(e->report, report, Q11K_REPORT_SIZE);
+
+    __atomic_store_n(&log->count, n + 1, __ATOMIC_RELEASE);
+}
+
+void q11k_emu_log_finish(q11k_emu_log_t* log)
+{
+    __atomic_store_n(&log->done, 1, __ATOMIC_RELEASE);
+}
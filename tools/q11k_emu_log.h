@@ -0,0 +1,50 @@
+/*
+ * Injection log shared between q11k_emu and q11k_latency.
+ *
+ * The emulator appends every report it writes to /dev/uhid together with
+ * the CLOCK_MONOTONIC time of the write; the latency tool maps the same
+ * file and matches the evdev frames it reads against it.
+ */
+#ifndef __Q11K_EMU_LOG_H
+#define __Q11K_EMU_LOG_H
+
+#include "q11k_core.h"
+
+#define Q11K_EMU_LOG_MAGIC      0x4b313151
+#define Q11K_EMU_LOG_DEFAULT    "/dev/shm/q11k-emu.log"
+
+struct q11k_emu_log_entry
+{
+    u64 t_ns;
+    u8 report[Q11K_REPORT_SIZE];
+    u32 seq;
+};
+
+typedef struct __tag_q11k_emu_log_t
+{
+    u32 magic;
+    u32 done;
+    u64 capacity;
+    u64 count;
+    struct q11k_emu_log_entry e[];
+} q11k_emu_log_t;
+
+/* Create (truncating) a log for @capacity entries, or map an existing one */
+q11k_emu_log_t* q11k_emu_log_create(const char* path, u64 capacity);
+q11k_emu_log_t* q11k_emu_log_open(const char* path);
+void q11k_emu_log_close(q11k_emu_log_t* log);
+
+void q11k_emu_log_append(q11k_emu_log_t* log, u64 t_ns, const u8* report);
+void q11k_emu_log_finish(q11k_emu_log_t* log);
+
+static inline u64 q11k_emu_log_count(const q11k_emu_log_t* log)
+{
+    return __atomic_load_n(&log->count, __ATOMIC_ACQUIRE);
+}
+
+static inline bool q11k_emu_log_done(const q11k_emu_log_t* log)
+{
+    return __atomic_load_n(&log->done, __ATOMIC_ACQUIRE) != 0;
+}
+
+#endif
@@ -0,0 +1,685 @@
+/*
+ * Injection to event latency of the Q11K driver.
+ *
+ * Reads the "Huion Q11K Tablet" and "Huion Q11K Keyboard" evdev nodes
+ * while q11k_emu plays reports into a virtual tablet, matches every frame
+ * against the emulator's injection log and prints latency percentiles and
+ * dropped frames.
+ *
+ * Pen frames are matched by decoded position (a frame that takes the pen
+ * out of range to the 0xc0 leave report), so the relative pen mode,
+ * the pen filter and the jitter deadband must be off. The deadband is on
+ * by default and holds a resting pen, so this tool turns it off on the
+ * pen's HID device before the emulator starts playing and puts the old
+ * setting back when it exits; under q11k_uinputd, which has no sysfs,
+ * run the daemon with -D. Keyboard frames are matched in order to the
+ * pad reports.
+ *
+ * It also checks the frame timestamps: evdev times and the pen's
+ * MSC_TIMESTAMP must never go backwards and must agree with each other,
+ * and the interval between two matched frames should equal the interval
+ * between their injections ("interval error" is the difference).
+ *
+ * With -S it plays a slow client: it sleeps between reads and then drains
+ * what queued up meanwhile, so the worst backlog shows how close the evdev
+ * client buffer came to SYN_DROPPED.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+#include "q11k_core.h"
+#include "q11k_uhid.h"
+#include "q11k_emu_log.h"
+
+#define PEN_NAME            "Huion Q11K Tablet"
+#define KEYBOARD_NAME       "Huion Q11K Keyboard"
+#define MATCH_WINDOW        65536
+#define DEFAULT_IDLE_MS     1000
+#define LOG_WAIT_MS         10000
+
+typedef struct __tag_lat_samples_t
+{
+    u64* v;
+    size_t count;
+    size_t alloc;
+} lat_samples_t;
+
+typedef struct __tag_lat_dev_t
+{
+    int fd;
+    char path[300];
+
+    /* frame being assembled */
+    int x;
+    int y;
+    bool pos_changed;
+    bool left;              /* BTN_TOOL_PEN went to 0 */
+    bool in_drop;
+
+    /* next log entry to match */
+    u64 next;
+
+    unsigned long frames;
+    unsigned long matched;
+    unsigned long unmatched;
+    unsigned long dropped;
+    unsigned long syn_dropped;
+
+    /* most events and frames one drain found queued */
+    unsigned long max_backlog_events;
+    unsigned long max_backlog_frames;
+
+    /* timestamp checks */
+    u64 last_frame_ns;
+    u64 last_ev_ns;
+    u64 last_inj_ns;
+    bool msc_seen;
+    u32 msc;
+    bool have_last_msc;
+    u32 last_msc;
+    unsigned long backwards;
+    unsigned long msc_backwards;
+    unsigned long msc_mismatch;
+
+    lat_samples_t evdev_lat;
+    lat_samples_t read_lat;
+    lat_samples_t interval_err;
+} lat_dev_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    stop_requested = 1;
+}
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void samples_push(lat_samples_t* s, u64 v)
+{
+    if (s->count == s->alloc)
+    {
+        s->alloc = s->alloc ? s->alloc * 2 : 4096;
+        s->v = realloc(s->v, s->alloc * sizeof(*s->v));
+        if (s->v == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    s->v[s->count++] = v;
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const lat_samples_t* s, double p)
+{
+    size_t idx;
+
+    if (s->count == 0)
+    {
+        return 0;
+    }
+    idx = (size_t)(p / 100.0 * (s->count - 1) + 0.5);
+    return s->v[idx] / 1000.0;
+}
+
+static void print_latency(const char* what, lat_samples_t* s)
+{
+    if (s->count == 0)
+    {
+        printf("  %-18s no samples\n", what);
+        return;
+    }
+
+    qsort(s->v, s->count, sizeof(*s->v), cmp_u64);
+    printf("  %-18s p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  max %8.1f us\n",
+           what, percentile(s, 50), percentile(s, 99), percentile(s, 99.9),
+           s->v[s->count - 1] / 1000.0);
+}
+
+static int find_device(const char* name, char* path, size_t path_len)
+{
+    DIR* dir = opendir("/dev/input");
+    struct dirent* de;
+    int found = -1;
+
+    if (dir == NULL)
+    {
+        return -1;
+    }
+
+    /* take the newest node with a matching name */
+    while ((de = readdir(dir)) != NULL)
+    {
+        char p[300];
+        char dev_name[256];
+        int fd, n;
+
+        if (sscanf(de->d_name, "event%d", &n) != 1)
+        {
+            continue;
+        }
+        snprintf(p, sizeof(p), "/dev/input/%s", de->d_name);
+        fd = open(p, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+        memset(dev_name, 0, sizeof(dev_name));
+        if (ioctl(fd, EVIOCGNAME(sizeof(dev_name) - 1), dev_name) >= 0
+            && strcmp(dev_name, name) == 0 && n > found)
+        {
+            found = n;
+            snprintf(path, path_len, "%s", p);
+        }
+        close(fd);
+    }
+
+    closedir(dir);
+    return (found >= 0) ? 0 : -1;
+}
+
+/* The module's deadband/enable and its value before deadband_off() */
+static char deadband_path[400];
+static char deadband_saved[16];
+
+static void deadband_restore(void)
+{
+    int fd = open(deadband_path, O_WRONLY | O_CLOEXEC);
+
+    if (fd < 0 || write(fd, deadband_saved, strlen(deadband_saved)) < 0)
+    {
+        fprintf(stderr, "could not restore %s to %s\n", deadband_path, deadband_saved);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/*
+ * Turn off the deadband of the module's tablet behind the pen node, until
+ * the tool exits. A held position never matches its report and would
+ * count as dropped. Returns -1 if the module's setting exists but cannot
+ * be changed.
+ */
+static int deadband_off(const char* evdev_path)
+{
+    const char* node = strrchr(evdev_path, '/');
+    ssize_t len;
+    int fd;
+
+    snprintf(deadband_path, sizeof(deadband_path), "/sys/class/input/%s/device/device/deadband/enable",
+             (node != NULL) ? node + 1 : evdev_path);
+    fd = open(deadband_path, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            /* not the module, e.g. q11k_uinputd */
+            fprintf(stderr, "%s has no deadband setting; for q11k_uinputd pass -D\n", evdev_path);
+            return 0;
+        }
+        perror(deadband_path);
+        return -1;
+    }
+
+    len = read(fd, deadband_saved, sizeof(deadband_saved) - 1);
+    if (len <= 0)
+    {
+        perror(deadband_path);
+        close(fd);
+        return -1;
+    }
+    deadband_saved[len] = '\0';
+    deadband_saved[strcspn(deadband_saved, "\n")] = '\0';
+
+    /* SIGINT and SIGTERM only stop the main loop, so main returns */
+    atexit(deadband_restore);
+    if (pwrite(fd, "0", 1, 0) != 1)
+    {
+        perror(deadband_path);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+static int open_device(lat_dev_t* d, const char* path, const char* name)
+{
+    int clk = CLOCK_MONOTONIC;
+
+    memset(d, 0, sizeof(*d));
+    d->fd = -1;
+    d->x = -1;
+    d->y = -1;
+
+    if (path != NULL)
+    {
+        snprintf(d->path, sizeof(d->path), "%s", path);
+    }
+    else if (find_device(name, d->path, sizeof(d->path)) != 0)
+    {
+        fprintf(stderr, "no evdev node named \"%s\"\n", name);
+        return -1;
+    }
+
+    d->fd = open(d->path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (d->fd < 0)
+    {
+        perror(d->path);
+        return -1;
+    }
+
+    if (ioctl(d->fd, EVIOCSCLOCKID, &clk) != 0)
+    {
+        perror("EVIOCSCLOCKID");
+    }
+
+    return 0;
+}
+
+static bool entry_is_pen(const struct q11k_emu_log_entry* e)
+{
+    return q11k_report_iface(e->report) == Q11K_UHID_IFACE_PEN;
+}
+
+/* 0xc0, the pen leaving range; it carries no position */
+static bool entry_is_leave(const struct q11k_emu_log_entry* e)
+{
+    return e->report[1] == 0xc0;
+}
+
+static void entry_pos(const struct q11k_emu_log_entry* e, int* x, int* y)
+{
+    int pressure;
+
+    if (e->report[1] == 0x90)
+    {
+        q11k_calculate_mouse_data(e->report, x, y);
+    }
+    else
+    {
+        q11k_calculate_pen_data(e->report, x, y, &pressure);
+    }
+}
+
+static bool entry_at(const struct q11k_emu_log_entry* e, int x, int y)
+{
+    int ex, ey;
+
+    if (entry_is_leave(e))
+    {
+        return false;
+    }
+    entry_pos(e, &ex, &ey);
+    return ex == x && ey == y;
+}
+
+static void record(lat_dev_t* d, const struct q11k_emu_log_entry* e, u64 ev_ns, u64 read_ns)
+{
+    d->matched++;
+    samples_push(&d->evdev_lat, (ev_ns > e->t_ns) ? ev_ns - e->t_ns : 0);
+    samples_push(&d->read_lat, (read_ns > e->t_ns) ? read_ns - e->t_ns : 0);
+
+    if (d->last_inj_ns != 0)
+    {
+        int64_t err = (int64_t)(ev_ns - d->last_ev_ns) - (int64_t)(e->t_ns - d->last_inj_ns);
+        samples_push(&d->interval_err, (err < 0) ? -err : err);
+    }
+    d->last_ev_ns = ev_ns;
+    d->last_inj_ns = e->t_ns;
+}
+
+/* Called on every complete frame, before it is matched */
+static void check_timestamps(lat_dev_t* d, u64 ev_ns)
+{
+    if (ev_ns < d->last_frame_ns)
+    {
+        d->backwards++;
+    }
+    d->last_frame_ns = ev_ns;
+
+    if (!d->msc_seen)
+    {
+        return;
+    }
+
+    /* MSC_TIMESTAMP is in wrapping microseconds */
+    if (d->have_last_msc && (int32_t)(d->msc - d->last_msc) < 0)
+    {
+        d->msc_backwards++;
+    }
+    if (d->msc != (u32)(ev_ns / 1000))
+    {
+        d->msc_mismatch++;
+    }
+    d->last_msc = d->msc;
+    d->have_last_msc = true;
+    d->msc_seen = false;
+}
+
+/*
+ * Match a pen frame to the next pen entry of the log: a frame that took
+ * the pen out of range to a leave report, any other to the report with
+ * its position
+ */
+static void match_pen_frame(lat_dev_t* d, const q11k_emu_log_t* log, u64 ev_ns, u64 read_ns)
+{
+    u64 count = q11k_emu_log_count(log);
+    u64 limit = (count - d->next > MATCH_WINDOW) ? d->next + MATCH_WINDOW : count;
+    unsigned long skipped = 0;
+    u64 j;
+
+    for (j = d->next; j < limit; j++)
+    {
+        const struct q11k_emu_log_entry* e = &log->e[j];
+
+        if (!entry_is_pen(e))
+        {
+            continue;
+        }
+
+        if (d->left ? entry_is_leave(e) : entry_at(e, d->x, d->y))
+        {
+            record(d, e, ev_ns, read_ns);
+            d->dropped += skipped;
+            d->next = j + 1;
+            return;
+        }
+        skipped++;
+    }
+
+    d->unmatched++;
+}
+
+static void match_pad_frame(lat_dev_t* d, const q11k_emu_log_t* log, u64 ev_ns, u64 read_ns)
+{
+    u64 count = q11k_emu_log_count(log);
+
+    while (d->next < count && entry_is_pen(&log->e[d->next]))
+    {
+        d->next++;
+    }
+
+    if (d->next < count)
+    {
+        record(d, &log->e[d->next], ev_ns, read_ns);
+        d->next++;
+    }
+    else
+    {
+        d->unmatched++;
+    }
+}
+
+static int drain(lat_dev_t* d, const q11k_emu_log_t* log, bool pen)
+{
+    struct input_event ev[64];
+    ssize_t n;
+    int total = 0;
+    unsigned long frames = 0;
+
+    while ((n = read(d->fd, ev, sizeof(ev))) > 0)
+    {
+        u64 read_ns = now_ns();
+        size_t i, cnt = n / sizeof(ev[0]);
+
+        for (i = 0; i < cnt; i++)
+        {
+            u64 ev_ns = (u64)ev[i].input_event_sec * 1000000000ull + ev[i].input_event_usec * 1000ull;
+
+            if (ev[i].type == EV_SYN && ev[i].code == SYN_DROPPED)
+            {
+                d->syn_dropped++;
+                d->in_drop = true;
+                continue;
+            }
+
+            if (ev[i].type == EV_SYN && ev[i].code == SYN_REPORT)
+            {
+                frames++;
+                if (!d->in_drop)
+                {
+                    d->frames++;
+                    check_timestamps(d, ev_ns);
+                    if (!pen)
+                    {
+                        match_pad_frame(d, log, ev_ns, read_ns);
+                    }
+                    else if (d->pos_changed || d->left)
+                    {
+                        match_pen_frame(d, log, ev_ns, read_ns);
+                    }
+                }
+                d->in_drop = false;
+                d->pos_changed = false;
+                d->left = false;
+                d->msc_seen = false;
+                continue;
+            }
+
+            if (ev[i].type == EV_MSC && ev[i].code == MSC_TIMESTAMP)
+            {
+                d->msc = (u32)ev[i].value;
+                d->msc_seen = true;
+                continue;
+            }
+
+            if (ev[i].type == EV_KEY && ev[i].code == BTN_TOOL_PEN && ev[i].value == 0)
+            {
+                d->left = true;
+            }
+            else if (ev[i].type == EV_ABS && ev[i].code == ABS_X)
+            {
+                d->x = ev[i].value;
+                d->pos_changed = true;
+            }
+            else if (ev[i].type == EV_ABS && ev[i].code == ABS_Y)
+            {
+                d->y = ev[i].value;
+                d->pos_changed = true;
+            }
+        }
+        total += cnt;
+    }
+
+    if (total > d->max_backlog_events)
+    {
+        d->max_backlog_events = total;
+    }
+    if (frames > d->max_backlog_frames)
+    {
+        d->max_backlog_frames = frames;
+    }
+
+    if (n < 0 && errno != EAGAIN)
+    {
+        return -errno;
+    }
+    return total;
+}
+
+static unsigned long count_pen_entries(const q11k_emu_log_t* log, u64 from, u64 to)
+{
+    unsigned long n = 0;
+    u64 j;
+
+    for (j = from; j < to; j++)
+    {
+        n += entry_is_pen(&log->e[j]);
+    }
+    return n;
+}
+
+static void print_device(const char* what, lat_dev_t* d)
+{
+    printf("%s (%s): %lu frames, %lu matched, %lu unmatched, %lu dropped, %lu SYN_DROPPED\n",
+           what, d->path, d->frames, d->matched, d->unmatched, d->dropped, d->syn_dropped);
+    print_latency("inject->evdev", &d->evdev_lat);
+    print_latency("inject->read", &d->read_lat);
+    print_latency("interval error", &d->interval_err);
+    printf("  timestamps: %lu backwards, %lu MSC_TIMESTAMP backwards, %lu MSC_TIMESTAMP != event time\n",
+           d->backwards, d->msc_backwards, d->msc_mismatch);
+    printf("  worst backlog: %lu events, %lu frames\n", d->max_backlog_events, d->max_backlog_frames);
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -l PATH     injection log written by q11k_emu (default %s)\n"
+        "  -p DEV      pen evdev node (default: newest \"%s\")\n"
+        "  -k DEV      keyboard evdev node (default: newest \"%s\")\n"
+        "  -i MS       stop after MS of silence once playback is done (default %d)\n"
+        "  -S US       slow reader: sleep US microseconds before each read\n",
+        prog, Q11K_EMU_LOG_DEFAULT, PEN_NAME, KEYBOARD_NAME, DEFAULT_IDLE_MS);
+}
+
+int main(int argc, char** argv)
+{
+    const char* log_path = Q11K_EMU_LOG_DEFAULT;
+    const char* pen_path = NULL;
+    const char* kbd_path = NULL;
+    int idle_ms = DEFAULT_IDLE_MS;
+    long slow_us = 0;
+    q11k_emu_log_t* log = NULL;
+    lat_dev_t pen, kbd;
+    u64 last_activity, waited = 0;
+    unsigned long injected;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:p:k:i:S:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l': log_path = optarg; break;
+            case 'p': pen_path = optarg; break;
+            case 'k': kbd_path = optarg; break;
+            case 'i': idle_ms = atoi(optarg); break;
+            case 'S': slow_us = atol(optarg); break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    /* the emulator may still be creating the device and the log */
+    while (!stop_requested)
+    {
+        if (access(log_path, R_OK) == 0
+            && (pen_path != NULL || find_device(PEN_NAME, pen.path, sizeof(pen.path)) == 0)
+            && (kbd_path != NULL || find_device(KEYBOARD_NAME, kbd.path, sizeof(kbd.path)) == 0))
+        {
+            break;
+        }
+        if (waited >= LOG_WAIT_MS)
+        {
+            fprintf(stderr, "timed out waiting for q11k_emu\n");
+            return 1;
+        }
+        usleep(50000);
+        waited += 50;
+    }
+
+    /* the emulator plays once both nodes are open, so the deadband goes
+       off before the first report */
+    if (open_device(&pen, pen_path, PEN_NAME) != 0 || deadband_off(pen.path) != 0
+        || open_device(&kbd, kbd_path, KEYBOARD_NAME) != 0)
+    {
+        return 1;
+    }
+
+    log = q11k_emu_log_open(log_path);
+    if (log == NULL)
+    {
+        return 1;
+    }
+
+    last_activity = now_ns();
+    while (!stop_requested)
+    {
+        struct pollfd pfd[2] = {
+            { .fd = pen.fd, .events = POLLIN },
+            { .fd = kbd.fd, .events = POLLIN },
+        };
+        int rc;
+
+        if (slow_us > 0)
+        {
+            usleep(slow_us);
+        }
+        rc = poll(pfd, 2, 100);
+
+        if (rc < 0 && errno != EINTR)
+        {
+            perror("poll");
+            break;
+        }
+
+        if (rc > 0)
+        {
+            int a = drain(&pen, log, true);
+            int b = drain(&kbd, log, false);
+
+            if (a < 0 || b < 0)
+            {
+                /* device removed */
+                break;
+            }
+            if (a + b > 0)
+            {
+                last_activity = now_ns();
+            }
+        }
+
+        if (q11k_emu_log_done(log) && now_ns() - last_activity > (u64)idle_ms * 1000000ull)
+        {
+            break;
+        }
+    }
+
+    injected = count_pen_entries(log, 0, q11k_emu_log_count(log));
+    /* pen reports after the last matched frame never arrived */
+    pen.dropped += count_pen_entries(log, pen.next, q11k_emu_log_count(log));
+
+    printf("injected: %lu pen reports, %lu pad reports\n",
+           injected, (unsigned long)q11k_emu_log_count(log) - injected);
+    print_device("pen", &pen);
+    print_device("keyboard", &kbd);
+
+    q11k_emu_log_close(log);
+    close(pen.fd);
+    close(kbd.fd);
+
+    if (pen.backwards || kbd.backwards || pen.msc_backwards || pen.msc_mismatch)
+    {
+        return 4;
+    }
+    return (pen.dropped || pen.syn_dropped || kbd.syn_dropped) ? 3 : 0;
+}
@@ -0,0 +1,75 @@
+#!/bin/bash
+#
+# Compare the kernel module and q11k_uinputd: plays the same uhid stream
+# through one path and prints latency (q11k_latency) and CPU per report.
+#
+#   kernel: q11k_device must be loaded; CPU is the system-wide busy time
+#           (user+system+irq+softirq from /proc/stat) per report.
+#   daemon: q11k_device must not be loaded; also prints the daemon's own
+#           user+sys time per report.
+#
+# usage: q11k_pathbench.bash kernel|daemon [rate_hz] [seconds]
+
+set -e
+
+MODE="$1"
+RATE="${2:-1000}"
+SECONDS_TO_RUN="${3:-10}"
+DIR="$(cd "$(dirname "$0")" && pwd)"
+LOG="/tmp/q11k_pathbench.$$"
+
+if [ "$MODE" != "kernel" ] && [ "$MODE" != "daemon" ]; then
+    echo "usage: $0 kernel|daemon [rate_hz] [seconds]" >&2
+    exit 2
+fi
+
+if [ "$MODE" = "kernel" ] && [ ! -d /sys/module/q11k_device ]; then
+    echo "$0: load q11k_device first" >&2
+    exit 1
+fi
+if [ "$MODE" = "daemon" ] && [ -d /sys/module/q11k_device ]; then
+    echo "$0: unload q11k_device first (rmmod q11k_device)" >&2
+    exit 1
+fi
+
+busy_jiffies() {
+    # user nice system idle iowait irq softirq
+    awk '/^cpu / { print $2 + $3 + $4 + $7 + $8 }' /proc/stat
+}
+
+DAEMON_PID=""
+cleanup() {
+    [ -n "$DAEMON_PID" ] && kill "$DAEMON_PID" 2>/dev/null || true
+    rm -f "$LOG" "$LOG.latency" "$LOG.emu" "$LOG.daemon"
+}
+trap cleanup EXIT
+
+if [ "$MODE" = "daemon" ]; then
+    # q11k_latency turns the module's deadband off itself, the daemon's here
+    "$DIR/q11k_uinputd" -w -D 2> "$LOG.daemon" &
+    DAEMON_PID=$!
+fi
+
+# the emulator waits until both evdev nodes have a reader
+"$DIR/q11k_latency" -l "$LOG" > "$LOG.latency" &
+LATENCY_PID=$!
+
+BUSY0=$(busy_jiffies)
+"$DIR/q11k_emu" -b -r "$RATE" -t "$SECONDS_TO_RUN" -l "$LOG" 2> "$LOG.emu"
+BUSY1=$(busy_jiffies)
+
+wait "$LATENCY_PID" || true
+if [ -n "$DAEMON_PID" ]; then
+    kill -INT "$DAEMON_PID" 2>/dev/null || true
+    wait "$DAEMON_PID" || true
+    DAEMON_PID=""
+fi
+
+REPORTS=$(sed -n 's/.*played \([0-9]*\) reports.*/\1/p' "$LOG.emu")
+HZ=$(getconf CLK_TCK)
+
+echo "== $MODE path, $REPORTS reports at $RATE Hz"
+cat "$LOG.latency"
+awk -v j=$((BUSY1 - BUSY0)) -v hz="$HZ" -v n="$REPORTS" \
+    'BEGIN { if (n > 0) printf("system busy: %.0f ns/report (includes the emulator)\n", j * 1e9 / hz / n) }'
+[ -f "$LOG.daemon" ] && grep '^q11k_uinputd' "$LOG.daemon" || true
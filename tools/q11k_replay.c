@@ -0,0 +1,357 @@
+/*
+ * Replays reports recorded by the driver (debugfs "record", see
+ * q11k_record.h) into a virtual Q11K on /dev/uhid, at the recorded pace
+ * or scaled by a speed factor.
+ *
+ * Captures are the q11k_record_t entries the record file reads out
+ * (cat record > capture.bin), or a snapshot taken through mmap with -c.
+ * Like q11k_emu, every injected report goes to the injection log, so
+ * q11k_latency measures a replay the same way as a scripted run.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "q11k_uhid.h"
+#include "q11k_emu_log.h"
+#include "q11k_record.h"
+
+#define WAIT_OPEN_MS        30000
+#define LINGER_MS           1000
+
+typedef struct __tag_capture_t
+{
+    q11k_record_t* e;
+    size_t count;
+} capture_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    stop_requested = 1;
+}
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until(u64 t_ns, bool busy)
+{
+    struct timespec ts;
+
+    if (busy)
+    {
+        while (now_ns() < t_ns)
+        {
+        }
+        return;
+    }
+
+    ts.tv_sec = t_ns / 1000000000ull;
+    ts.tv_nsec = t_ns % 1000000000ull;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !stop_requested)
+    {
+    }
+}
+
+static int load_capture(capture_t* c, const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    struct stat st;
+
+    if (f == NULL || fstat(fileno(f), &st) != 0)
+    {
+        perror(path);
+        if (f != NULL)
+        {
+            fclose(f);
+        }
+        return -1;
+    }
+
+    if (st.st_size == 0 || st.st_size % sizeof(q11k_record_t) != 0)
+    {
+        fprintf(stderr, "%s: not a capture (size %lld)\n", path, (long long)st.st_size);
+        fclose(f);
+        return -1;
+    }
+
+    c->count = st.st_size / sizeof(q11k_record_t);
+    c->e = malloc(st.st_size);
+    if (c->e == NULL || fread(c->e, sizeof(q11k_record_t), c->count, f) != c->count)
+    {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/*
+ * Copy the driver's ring through mmap, oldest entry first. Entries that
+ * are overwritten or half written while copying are skipped.
+ */
+static int snapshot_ring(const char* record_path, const char* out_path)
+{
+    const q11k_record_ring_t* ring;
+    size_t size = Q11K_RECORD_HEADER_SIZE;
+    unsigned long written = 0, skipped = 0;
+    u64 head, seq;
+    u32 entries;
+    FILE* out;
+    int fd;
+
+    fd = open(record_path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(record_path);
+        return 1;
+    }
+
+    ring = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+    {
+        perror("mmap (is recording enabled in record_entries?)");
+        close(fd);
+        return 1;
+    }
+    entries = ring->entries;
+    if (ring->magic != Q11K_RECORD_MAGIC || entries == 0 || (entries & (entries - 1)) != 0)
+    {
+        fprintf(stderr, "%s: bad ring header\n", record_path);
+        munmap((void*)ring, size);
+        close(fd);
+        return 1;
+    }
+    munmap((void*)ring, size);
+
+    size = q11k_record_ring_size(entries);
+    ring = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    out = fopen(out_path, "wb");
+    if (out == NULL)
+    {
+        perror(out_path);
+        munmap((void*)ring, size);
+        return 1;
+    }
+
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    seq = (head > entries) ? head - entries + 1 : 1;
+    for (; seq <= head; seq++)
+    {
+        const q11k_record_t* e = &ring->e[(seq - 1) & (entries - 1)];
+        q11k_record_t copy;
+        u64 s1, s2;
+
+        s1 = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        memcpy(&copy, e, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s2 = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+
+        if (s1 != seq || s2 != seq)
+        {
+            skipped++;
+            continue;
+        }
+        fwrite(&copy, sizeof(copy), 1, out);
+        written++;
+    }
+
+    fclose(out);
+    munmap((void*)ring, size);
+    fprintf(stderr, "%s: %lu reports, %lu skipped\n", out_path, written, skipped);
+    return 0;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options] CAPTURE\n"
+        "       %s -c RECORD CAPTURE\n"
+        "  -c RECORD   snapshot the debugfs record ring into CAPTURE and exit\n"
+        "  -x SPEED    replay SPEED times faster than recorded (default 1,\n"
+        "              0 = as fast as possible)\n"
+        "  -r COUNT    play the capture COUNT times (default 1)\n"
+        "  -l PATH     injection log for q11k_latency (default %s)\n"
+        "  -L          do not write an injection log\n"
+        "  -T TAG      phys/uniq prefix of the virtual tablet (default q11k-replay-PID)\n"
+        "  -b          busy-wait between reports for accurate pacing\n"
+        "  -k          keep the device after playback until interrupted\n"
+        "  -v          print uhid events\n",
+        prog, prog, Q11K_EMU_LOG_DEFAULT);
+}
+
+int main(int argc, char** argv)
+{
+    capture_t cap;
+    q11k_uhid_t uhid;
+    q11k_emu_log_t* log = NULL;
+    const char* log_path = Q11K_EMU_LOG_DEFAULT;
+    const char* record_path = NULL;
+    char tag[64];
+    double speed = 1.0;
+    unsigned long repeat = 1, played = 0, late = 0;
+    unsigned long i, pass;
+    bool busy = false, keep = false, use_log = true;
+    u64 start, end, base, max_lag = 0, sum_lag = 0;
+    int opt, rc;
+
+    memset(&cap, 0, sizeof(cap));
+    memset(&uhid, 0, sizeof(uhid));
+    snprintf(tag, sizeof(tag), "q11k-replay-%d", (int)getpid());
+
+    while ((opt = getopt(argc, argv, "c:x:r:l:LT:bkvh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': record_path = optarg; break;
+            case 'x': speed = atof(optarg); break;
+            case 'r': repeat = strtoul(optarg, NULL, 0); break;
+            case 'l': log_path = optarg; break;
+            case 'L': use_log = false; break;
+            case 'T': snprintf(tag, sizeof(tag), "%s", optarg); break;
+            case 'b': busy = true; break;
+            case 'k': keep = true; break;
+            case 'v': uhid.verbose = true; break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (optind != argc - 1 || speed < 0 || repeat == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (record_path != NULL)
+    {
+        return snapshot_ring(record_path, argv[optind]);
+    }
+
+    if (load_capture(&cap, argv[optind]) != 0)
+    {
+        return 1;
+    }
+
+    if (use_log)
+    {
+        log = q11k_emu_log_create(log_path, cap.count * repeat);
+        if (log == NULL)
+        {
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    rc = q11k_uhid_create(&uhid, tag);
+    if (rc < 0)
+    {
+        fprintf(stderr, "cannot create uhid device: %s\n", strerror(-rc));
+        return 1;
+    }
+
+    /* the driver only starts I/O once both evdev nodes have a reader */
+    fprintf(stderr, "%s: waiting for a reader (e.g. q11k_latency) to open the input devices\n", tag);
+    rc = q11k_uhid_wait_open(&uhid, WAIT_OPEN_MS);
+    if (rc < 0)
+    {
+        fprintf(stderr, "%s: device was not opened, is q11k_device loaded and its input read?\n", tag);
+        q11k_uhid_destroy(&uhid);
+        return 1;
+    }
+
+    start = base = now_ns();
+    for (pass = 0; pass < repeat && !stop_requested; pass++)
+    {
+        u64 t0 = cap.e[0].t_ns;
+
+        for (i = 0; i < cap.count && !stop_requested; i++)
+        {
+            const q11k_record_t* e = &cap.e[i];
+            u64 due = base, t;
+
+            if (speed > 0 && e->t_ns > t0)
+            {
+                due += (u64)((e->t_ns - t0) / speed);
+                sleep_until(due, busy);
+            }
+
+            t = now_ns();
+            if (t > due)
+            {
+                sum_lag += t - due;
+                max_lag = (t - due > max_lag) ? t - due : max_lag;
+                late += (t - due > 1000000);
+            }
+            if (q11k_uhid_send(&uhid, e->report) < 0)
+            {
+                perror("uhid write");
+                stop_requested = 1;
+                break;
+            }
+            if (log != NULL)
+            {
+                q11k_emu_log_append(log, t, e->report);
+            }
+            played++;
+
+            if ((played & 0x3f) == 0)
+            {
+                q11k_uhid_dispatch(&uhid, 0);
+            }
+        }
+        base = now_ns();
+    }
+    end = now_ns();
+
+    if (log != NULL)
+    {
+        q11k_emu_log_finish(log);
+    }
+
+    fprintf(stderr, "%s: played %lu reports in %.3f s (%.1f reports/s, %lu late)\n",
+            tag, played, (end - start) / 1e9, played * 1e9 / (end - start), late);
+    if (played != 0)
+    {
+        fprintf(stderr, "%s: schedule lag avg %.1f us, max %.1f us\n",
+                tag, sum_lag / 1e3 / played, max_lag / 1e3);
+    }
+
+    /* let readers drain their evdev buffers before the nodes go away */
+    q11k_uhid_dispatch(&uhid, LINGER_MS);
+    while (keep && !stop_requested)
+    {
+        q11k_uhid_dispatch(&uhid, 500);
+    }
+
+    q11k_uhid_destroy(&uhid);
+    q11k_emu_log_close(log);
+    free(cap.e);
+
+    return 0;
+}
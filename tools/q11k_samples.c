@@ -0,0 +1,324 @@
+/*
+ * Reader of the pen sample channel (/dev/q11k_penN, see q11k_sample.h).
+ *
+ * Maps the driver's sample ring and follows its head, reading samples in
+ * place. Waits for new samples with poll() and a read() of the head
+ * (default), an eventfd (-e), or by spinning on the head without any
+ * system call (-b). On exit it prints the samples read, samples lost to
+ * overruns, wakeups and the arrival to read latency.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "q11k_sample.h"
+
+#define DEFAULT_DEV         "/dev/q11k_pen0"
+
+enum wait_mode
+{
+    WAIT_POLL = 0,
+    WAIT_EVENTFD,
+    WAIT_BUSY
+};
+
+typedef struct __tag_lat_samples_t
+{
+    u64* v;
+    size_t count;
+    size_t alloc;
+} lat_samples_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    stop_requested = 1;
+}
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void samples_push(lat_samples_t* s, u64 v)
+{
+    if (s->count == s->alloc)
+    {
+        s->alloc = s->alloc ? s->alloc * 2 : 4096;
+        s->v = realloc(s->v, s->alloc * sizeof(*s->v));
+        if (s->v == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    s->v[s->count++] = v;
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const lat_samples_t* s, double p)
+{
+    size_t idx = (size_t)(p / 100.0 * (s->count - 1) + 0.5);
+    return s->v[idx] / 1000.0;
+}
+
+static u64 ring_head(const q11k_sample_ring_t* ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Block until the head moves; returns the head, 0 once the tablet is gone
+ * or on a signal.
+ */
+static u64 wait_samples(int fd, int efd, enum wait_mode mode, const q11k_sample_ring_t* ring, u64 last)
+{
+    u64 head, count;
+
+    switch (mode)
+    {
+        case WAIT_BUSY:
+            while (!stop_requested)
+            {
+                head = ring_head(ring);
+                if (head != last)
+                {
+                    return head;
+                }
+            }
+            return 0;
+
+        case WAIT_EVENTFD:
+        {
+            struct pollfd pfd[2] = {
+                { .fd = efd, .events = POLLIN },
+                { .fd = fd, .events = 0 },      /* for POLLHUP */
+            };
+
+            while (!stop_requested)
+            {
+                if (poll(pfd, 2, -1) < 0)
+                {
+                    continue;
+                }
+                if (pfd[1].revents & POLLHUP)
+                {
+                    return 0;
+                }
+                if ((pfd[0].revents & POLLIN) && read(efd, &count, sizeof(count)) == sizeof(count))
+                {
+                    return ring_head(ring);
+                }
+            }
+            return 0;
+        }
+
+        default:
+        {
+            ssize_t n;
+
+            /* read() blocks until there is something new and acks it */
+            do
+            {
+                n = read(fd, &head, sizeof(head));
+            }
+            while (n < 0 && errno == EINTR && !stop_requested);
+
+            return (n == sizeof(head)) ? head : 0;
+        }
+    }
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -d DEV      sample channel (default %s)\n"
+        "  -e          wait on an eventfd\n"
+        "  -b          spin on the ring head, no system calls\n"
+        "  -p          print every sample\n"
+        "  -t SECONDS  stop after SECONDS (default: when interrupted or the tablet goes)\n",
+        prog, DEFAULT_DEV);
+}
+
+int main(int argc, char** argv)
+{
+    const char* dev = DEFAULT_DEV;
+    enum wait_mode mode = WAIT_POLL;
+    const q11k_sample_ring_t* ring;
+    lat_samples_t lat = { NULL, 0, 0 };
+    unsigned long read_count = 0, lost = 0, wakeups = 0;
+    bool print = false;
+    double seconds = 0;
+    u64 last, start, stop_at = 0;
+    size_t size;
+    u32 entries;
+    int fd, efd = -1, opt;
+
+    while ((opt = getopt(argc, argv, "d:ebpt:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd': dev = optarg; break;
+            case 'e': mode = WAIT_EVENTFD; break;
+            case 'b': mode = WAIT_BUSY; break;
+            case 'p': print = true; break;
+            case 't': seconds = atof(optarg); break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    fd = open(dev, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(dev);
+        if (errno == ENOENT)
+        {
+            fprintf(stderr, "load q11k_device with pen_samples=N\n");
+        }
+        return 1;
+    }
+
+    ring = mmap(NULL, Q11K_SAMPLE_HEADER_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    entries = ring->entries;
+    if (ring->magic != Q11K_SAMPLE_MAGIC || entries == 0 || (entries & (entries - 1)) != 0)
+    {
+        fprintf(stderr, "%s: bad ring header\n", dev);
+        return 1;
+    }
+    munmap((void*)ring, Q11K_SAMPLE_HEADER_SIZE);
+
+    size = q11k_sample_ring_size(entries);
+    ring = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    if (mode == WAIT_EVENTFD)
+    {
+        efd = eventfd(0, EFD_CLOEXEC);
+        if (efd < 0 || ioctl(fd, Q11K_SAMPLE_IOC_SET_EVENTFD, &efd) != 0)
+        {
+            perror("eventfd");
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    if (seconds > 0)
+    {
+        signal(SIGALRM, on_signal);
+        alarm((unsigned int)(seconds + 0.999));
+        stop_at = now_ns() + (u64)(seconds * 1e9);
+    }
+
+    start = now_ns();
+    last = ring_head(ring);
+    while (!stop_requested)
+    {
+        u64 head = wait_samples(fd, efd, mode, ring, last);
+        u64 seq, t;
+
+        if (head == 0)
+        {
+            break;
+        }
+        wakeups++;
+
+        if (head - last > entries)
+        {
+            lost += head - last - entries;
+            last = head - entries;
+        }
+
+        t = now_ns();
+        for (seq = last + 1; seq <= head; seq++)
+        {
+            const q11k_sample_t* e = &ring->e[(seq - 1) & (entries - 1)];
+            u64 t_ns;
+            int x, y, pressure, prox, buttons;
+
+            if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != seq)
+            {
+                lost++;
+                continue;
+            }
+            t_ns = e->t_ns;
+            x = e->x;
+            y = e->y;
+            pressure = e->pressure;
+            prox = e->prox;
+            buttons = e->buttons;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) != seq)
+            {
+                lost++;
+                continue;
+            }
+
+            read_count++;
+            samples_push(&lat, t - t_ns);
+            if (print)
+            {
+                printf("%llu.%06llu x=%d y=%d pressure=%d prox=%d buttons=%d\n",
+                       (unsigned long long)(t_ns / 1000000000ull),
+                       (unsigned long long)(t_ns % 1000000000ull / 1000),
+                       x, y, pressure, prox, buttons);
+            }
+        }
+        last = head;
+
+        if (stop_at != 0 && t >= stop_at)
+        {
+            break;
+        }
+    }
+
+    printf("%s: %lu samples in %.3f s, %lu lost, %lu wakeups (%.2f samples/wakeup)\n",
+           dev, read_count, (now_ns() - start) / 1e9, lost, wakeups,
+           wakeups ? (double)read_count / wakeups : 0.0);
+    if (lat.count != 0)
+    {
+        qsort(lat.v, lat.count, sizeof(*lat.v), cmp_u64);
+        printf("  arrival to read     p50 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+               percentile(&lat, 50), percentile(&lat, 99), lat.v[lat.count - 1] / 1000.0);
+    }
+
+    munmap((void*)ring, size);
+    if (efd >= 0)
+    {
+        close(efd);
+    }
+    close(fd);
+    free(lat.v);
+    return 0;
+}
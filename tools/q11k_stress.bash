@@ -0,0 +1,47 @@
+#!/bin/bash
+#
+# Burst test of the evdev client buffers: plays pen strokes into a
+# virtual tablet at 1, 2 and 4 kHz while q11k_latency reads as a slow
+# client, and fails if any run loses a frame (SYN_DROPPED or a pen report
+# that never showed up). Prints the worst backlog the reader found.
+# q11k_latency turns the tablet's jitter deadband off while it runs, so held positions
+# do not count as lost frames.
+#
+# usage: q11k_stress.bash [reader_sleep_us] [seconds]
+
+READER_SLEEP_US="${1:-8000}"
+SECONDS_PER_RATE="${2:-5}"
+DIR="$(cd "$(dirname "$0")" && pwd)"
+LOG="/tmp/q11k_stress.$$"
+FAILED=0
+
+if [ ! -d /sys/module/q11k_device ]; then
+    echo "$0: load q11k_device first" >&2
+    exit 1
+fi
+
+cleanup() {
+    rm -f "$LOG" "$LOG.latency" "$LOG.emu"
+}
+trap cleanup EXIT
+
+for RATE in 1000 2000 4000; do
+    "$DIR/q11k_latency" -l "$LOG" -S "$READER_SLEEP_US" > "$LOG.latency" &
+    LATENCY_PID=$!
+
+    "$DIR/q11k_emu" -b -s stroke -r "$RATE" -t "$SECONDS_PER_RATE" -l "$LOG" 2> "$LOG.emu"
+    wait "$LATENCY_PID"
+    STATUS=$?
+
+    PEN=$(grep '^pen ' "$LOG.latency")
+    BACKLOG=$(grep -m1 'worst backlog' "$LOG.latency" | sed 's/^ *//')
+    printf "%5d Hz, reader sleeps %d us: %s\n" "$RATE" "$READER_SLEEP_US" "${PEN#*: }"
+    printf "          %s\n" "$BACKLOG"
+
+    if [ "$STATUS" -ne 0 ]; then
+        echo "          FAILED (q11k_latency exit $STATUS)"
+        FAILED=1
+    fi
+done
+
+exit $FAILED
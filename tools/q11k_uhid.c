@@ -0,0 +1,246 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/uhid.h>
+
+#include "q11k_uhid.h"
+
+static const u8 q11k_uhid_rdesc[] = {
+    0x06, 0x00, 0xff,       /* Usage Page (Vendor Defined 0xFF00) */
+    0x09, 0x01,             /* Usage (0x01) */
+    0xa1, 0x01,             /* Collection (Application) */
+    0x85, Q11K_REPORT_ID,   /*   Report ID (8) */
+    0x15, 0x00,             /*   Logical Minimum (0) */
+    0x26, 0xff, 0x00,       /*   Logical Maximum (255) */
+    0x75, 0x08,             /*   Report Size (8) */
+    0x95, Q11K_REPORT_SIZE - 1, /* Report Count (11) */
+    0x09, 0x01,             /*   Usage (0x01) */
+    0x81, 0x02,             /*   Input (Data,Var,Abs) */
+    0xc0                    /* End Collection */
+};
+
+static const char* q11k_uhid_event_names[] = {
+    [UHID_START]      = "START",
+    [UHID_STOP]       = "STOP",
+    [UHID_OPEN]       = "OPEN",
+    [UHID_CLOSE]      = "CLOSE",
+    [UHID_OUTPUT]     = "OUTPUT",
+    [UHID_GET_REPORT] = "GET_REPORT",
+    [UHID_SET_REPORT] = "SET_REPORT",
+};
+
+static int q11k_uhid_write(int fd, const struct uhid_event* ev)
+{
+    ssize_t rc = write(fd, ev, sizeof(*ev));
+
+    if (rc < 0)
+    {
+        return -errno;
+    }
+    return (rc == sizeof(*ev)) ? 0 : -EFAULT;
+}
+
+int q11k_uhid_create(q11k_uhid_t* u, const char* tag)
+{
+    int i;
+
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        u->fd[i] = -1;
+        u->started[i] = false;
+        u->opened[i] = false;
+    }
+
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        struct uhid_event ev;
+        int rc;
+
+        u->fd[i] = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+        if (u->fd[i] < 0)
+        {
+            rc = -errno;
+            q11k_uhid_destroy(u);
+            return rc;
+        }
+
+        memset(&ev, 0, sizeof(ev));
+        ev.type = UHID_CREATE2;
+        snprintf((char*)ev.u.create2.name, sizeof(ev.u.create2.name), "HUION Huion Tablet");
+        snprintf((char*)ev.u.create2.phys, sizeof(ev.u.create2.phys), "%s/input%d", tag, i);
+        snprintf((char*)ev.u.create2.uniq, sizeof(ev.u.create2.uniq), "%s", tag);
+        memcpy(ev.u.create2.rd_data, q11k_uhid_rdesc, sizeof(q11k_uhid_rdesc));
+        ev.u.create2.rd_size = sizeof(q11k_uhid_rdesc);
+        ev.u.create2.bus = BUS_USB;
+        ev.u.create2.vendor = Q11K_UHID_VENDOR;
+        ev.u.create2.product = Q11K_UHID_PRODUCT;
+
+        rc = q11k_uhid_write(u->fd[i], &ev);
+        if (rc < 0)
+        {
+            q11k_uhid_destroy(u);
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+void q11k_uhid_destroy(q11k_uhid_t* u)
+{
+    int i;
+
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        if (u->fd[i] >= 0)
+        {
+            struct uhid_event ev;
+
+            memset(&ev, 0, sizeof(ev));
+            ev.type = UHID_DESTROY;
+            q11k_uhid_write(u->fd[i], &ev);
+            close(u->fd[i]);
+            u->fd[i] = -1;
+        }
+    }
+}
+
+int q11k_uhid_send(q11k_uhid_t* u, const u8* report)
+{
+    struct uhid_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_INPUT2;
+    ev.u.input2.size = Q11K_REPORT_SIZE;
+    memcpy(ev.u.input2.data, report, Q11K_REPORT_SIZE);
+
+    return q11k_uhid_write(u->fd[q11k_report_iface(report)], &ev);
+}
+
+static void q11k_uhid_handle(q11k_uhid_t* u, int i, const struct uhid_event* ev)
+{
+    struct uhid_event reply;
+
+    if (u->verbose && ev->type < sizeof(q11k_uhid_event_names) / sizeof(q11k_uhid_event_names[0])
+        && q11k_uhid_event_names[ev->type] != NULL)
+    {
+        fprintf(stderr, "uhid: input%d %s\n", i, q11k_uhid_event_names[ev->type]);
+    }
+
+    switch (ev->type)
+    {
+        case UHID_START:
+        {
+            u->started[i] = true;
+            break;
+        }
+        case UHID_STOP:
+        {
+            u->started[i] = false;
+            break;
+        }
+        case UHID_OPEN:
+        {
+            u->opened[i] = true;
+            break;
+        }
+        case UHID_CLOSE:
+        {
+            u->opened[i] = false;
+            break;
+        }
+        case UHID_GET_REPORT:
+        {
+            memset(&reply, 0, sizeof(reply));
+            reply.type = UHID_GET_REPORT_REPLY;
+            reply.u.get_report_reply.id = ev->u.get_report.id;
+            reply.u.get_report_reply.err = EIO;
+            q11k_uhid_write(u->fd[i], &reply);
+            break;
+        }
+        case UHID_SET_REPORT:
+        {
+            memset(&reply, 0, sizeof(reply));
+            reply.type = UHID_SET_REPORT_REPLY;
+            reply.u.set_report_reply.id = ev->u.set_report.id;
+            reply.u.set_report_reply.err = EIO;
+            q11k_uhid_write(u->fd[i], &reply);
+            break;
+        }
+    }
+}
+
+int q11k_uhid_dispatch(q11k_uhid_t* u, int timeout_ms)
+{
+    struct pollfd pfd[Q11K_UHID_IFACES];
+    int i, rc, handled = 0;
+
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        pfd[i].fd = u->fd[i];
+        pfd[i].events = POLLIN;
+        pfd[i].revents = 0;
+    }
+
+    rc = poll(pfd, Q11K_UHID_IFACES, timeout_ms);
+    if (rc < 0)
+    {
+        return (errno == EINTR) ? 0 : -errno;
+    }
+
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        struct uhid_event ev;
+
+        if (!(pfd[i].revents & POLLIN))
+        {
+            continue;
+        }
+        if (read(u->fd[i], &ev, sizeof(ev)) > 0)
+        {
+            q11k_uhid_handle(u, i, &ev);
+            handled++;
+        }
+    }
+
+    return handled;
+}
+
+int q11k_uhid_wait_open(q11k_uhid_t* u, int timeout_ms)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (;;)
+    {
+        int i, open_count = 0;
+        long elapsed;
+
+        for (i = 0; i < Q11K_UHID_IFACES; i++)
+        {
+            open_count += u->opened[i];
+        }
+        if (open_count == Q11K_UHID_IFACES)
+        {
+            return 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (timeout_ms >= 0 && elapsed >= timeout_ms)
+        {
+            return -ETIMEDOUT;
+        }
+
+        if (q11k_uhid_dispatch(u, 50) < 0)
+        {
+            return -EIO;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Virtual Q11K on top of /dev/uhid.
+ *
+ * The real tablet shows up as two HID interfaces of one USB device; the
+ * driver tells them apart by interface number, which for uhid devices it
+ * reads from the "/inputN" suffix of phys. Both interfaces get a minimal
+ * vendor descriptor declaring the 12 byte report with ID 0x08.
+ */
+#ifndef __Q11K_UHID_H
+#define __Q11K_UHID_H
+
+#include "q11k_core.h"
+
+#define Q11K_UHID_IFACES        2
+#define Q11K_UHID_IFACE_PAD     0
+#define Q11K_UHID_IFACE_PEN     1
+
+#define Q11K_UHID_VENDOR        0x256c
+#define Q11K_UHID_PRODUCT       0x006e
+
+typedef struct __tag_q11k_uhid_t
+{
+    int fd[Q11K_UHID_IFACES];
+    bool started[Q11K_UHID_IFACES];
+    bool opened[Q11K_UHID_IFACES];
+    bool verbose;
+} q11k_uhid_t;
+
+/* Create both interfaces; @tag makes phys/uniq unique per virtual tablet */
+int q11k_uhid_create(q11k_uhid_t* u, const char* tag);
+void q11k_uhid_destroy(q11k_uhid_t* u);
+
+/* Inject one 12 byte report on the interface it belongs to */
+int q11k_uhid_send(q11k_uhid_t* u, const u8* report);
+
+/* Process pending uhid events (START/STOP/OPEN/CLOSE/GET_REPORT) */
+int q11k_uhid_dispatch(q11k_uhid_t* u, int timeout_ms);
+
+/* Wait until the driver has opened every interface for I/O */
+int q11k_uhid_wait_open(q11k_uhid_t* u, int timeout_ms);
+
+static inline int q11k_report_iface(const u8* report)
+{
+    return (report[1] >= 0xe0) ? Q11K_UHID_IFACE_PAD : Q11K_UHID_IFACE_PEN;
+}
+
+#endif
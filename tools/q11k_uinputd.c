@@ -0,0 +1,546 @@
+/*
+ * Userspace Q11K driver, for hosts that cannot load the module.
+ *
+ * Reads both HID interfaces of the tablet through hidraw, feeds every
+ * report to the same decoding core as q11k_raw_event() and writes the
+ * resulting frames to uinput devices named like the module's, so
+ * q11k_latency and user configuration work on either path.
+ *
+ * Reports are drained per epoll wakeup and every frame goes to uinput
+ * with a single write(). Per-report CPU time and batching are printed
+ * on exit (SIGINT/SIGTERM or when the tablet goes away).
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "q11k_core.h"
+#include "q11k_uhid.h"
+
+#define HIDRAW_CLASS        "/sys/class/hidraw"
+#define WAIT_POLL_MS        500
+#define EVENT_BUF           64
+#define READ_BUF            64
+
+typedef struct __tag_uinputd_dev_t
+{
+    int fd;
+    struct input_event buf[EVENT_BUF];
+    int count;
+} uinputd_dev_t;
+
+typedef struct __tag_uinputd_t
+{
+    q11k_state_t st;
+    uinputd_dev_t out[Q11K_INPUT_COUNT];
+    int hidraw[Q11K_UHID_IFACES];
+    char hidraw_path[Q11K_UHID_IFACES][64];
+
+    unsigned long reports;
+    unsigned long wakeups;
+    unsigned long frames;
+    unsigned long write_errors;
+} uinputd_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    stop_requested = 1;
+}
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * epoll timeout until the pen's proximity deadline (the module's
+ * prox_timer), -1 while it is out of range. Rounded up so that a wakeup
+ * finds the deadline passed.
+ */
+static int prox_timeout_ms(uinputd_t* d)
+{
+    u64 deadline = q11k_core_pen_deadline(&d->st);
+    u64 now = now_ns();
+
+    if (deadline == 0)
+    {
+        return -1;
+    }
+    if (deadline <= now)
+    {
+        return 0;
+    }
+    return (int)((deadline - now + 999999) / 1000000);
+}
+
+static void uinputd_flush(uinputd_t* d, enum q11k_input idev)
+{
+    uinputd_dev_t* o = &d->out[idev];
+    ssize_t len = (ssize_t)(o->count * sizeof(o->buf[0]));
+
+    if (o->count == 0)
+    {
+        return;
+    }
+    if (write(o->fd, o->buf, len) != len)
+    {
+        d->write_errors++;
+    }
+    o->count = 0;
+}
+
+static void uinputd_event(uinputd_t* d, enum q11k_input idev, u16 type, u16 code, int value)
+{
+    uinputd_dev_t* o = &d->out[idev];
+
+    if (o->count == EVENT_BUF)
+    {
+        uinputd_flush(d, idev);
+    }
+
+    /* the kernel stamps uinput events itself */
+    memset(&o->buf[o->count], 0, sizeof(o->buf[0]));
+    o->buf[o->count].type = type;
+    o->buf[o->count].code = code;
+    o->buf[o->count].value = value;
+    o->count++;
+}
+
+static void uinputd_report_key(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    uinputd_event(ctx, idev, EV_KEY, code, value);
+}
+
+static void uinputd_report_abs(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    uinputd_event(ctx, idev, EV_ABS, code, value);
+}
+
+static void uinputd_report_msc(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    uinputd_event(ctx, idev, EV_MSC, code, value);
+}
+
+static void uinputd_report_rel(void* ctx, enum q11k_input idev, unsigned int code, int value)
+{
+    uinputd_event(ctx, idev, EV_REL, code, value);
+}
+
+static void uinputd_sync(void* ctx, enum q11k_input idev, u64 time_ns)
+{
+    uinputd_t* d = ctx;
+
+    uinputd_event(d, idev, EV_SYN, SYN_REPORT, 0);
+    uinputd_flush(d, idev);
+    d->frames++;
+}
+
+static const struct q11k_sink_ops uinputd_sink_ops = {
+    .report_key = uinputd_report_key,
+    .report_abs = uinputd_report_abs,
+    .report_msc = uinputd_report_msc,
+    .report_rel = uinputd_report_rel,
+    .sync       = uinputd_sync,
+};
+
+/*
+ * Find the hidraw node of interface @iface: the newest one whose HID_ID
+ * is the Q11K and whose HID_PHYS ends in "/input<iface>", like the
+ * module's q11k_interface_number().
+ */
+static int find_hidraw(int iface, char* path, size_t path_len)
+{
+    DIR* dir = opendir(HIDRAW_CLASS);
+    struct dirent* de;
+    char id[64], suffix[16];
+    int found = -1;
+
+    if (dir == NULL)
+    {
+        return -errno;
+    }
+
+    snprintf(id, sizeof(id), "HID_ID=0003:%08X:%08X", Q11K_UHID_VENDOR, Q11K_UHID_PRODUCT);
+    snprintf(suffix, sizeof(suffix), "/input%d", iface);
+
+    while ((de = readdir(dir)) != NULL)
+    {
+        char p[300], line[256];
+        bool id_ok = false, phys_ok = false;
+        FILE* f;
+        int n;
+
+        if (sscanf(de->d_name, "hidraw%d", &n) != 1 || n <= found)
+        {
+            continue;
+        }
+
+        snprintf(p, sizeof(p), HIDRAW_CLASS "/%s/device/uevent", de->d_name);
+        f = fopen(p, "r");
+        if (f == NULL)
+        {
+            continue;
+        }
+        while (fgets(line, sizeof(line), f) != NULL)
+        {
+            size_t len;
+
+            line[strcspn(line, "\n")] = '\0';
+            len = strlen(line);
+            id_ok |= (strcasecmp(line, id) == 0);
+            phys_ok |= (strncmp(line, "HID_PHYS=", 9) == 0 && len >= strlen(suffix)
+                        && strcmp(line + len - strlen(suffix), suffix) == 0);
+        }
+        fclose(f);
+
+        if (id_ok && phys_ok)
+        {
+            found = n;
+        }
+    }
+    closedir(dir);
+
+    if (found < 0)
+    {
+        return -ENODEV;
+    }
+    snprintf(path, path_len, "/dev/hidraw%d", found);
+    return 0;
+}
+
+static int uinput_set(int fd, unsigned long req, int value)
+{
+    return (ioctl(fd, req, value) < 0) ? -errno : 0;
+}
+
+static int uinput_abs(int fd, unsigned int code, int max)
+{
+    struct uinput_abs_setup abs;
+
+    memset(&abs, 0, sizeof(abs));
+    abs.code = code;
+    abs.absinfo.minimum = 0;
+    abs.absinfo.maximum = max;
+
+    return (ioctl(fd, UI_ABS_SETUP, &abs) < 0) ? -errno : 0;
+}
+
+/* Capabilities mirror q11k_register_pen/keyboard/scroll() */
+static int uinput_create(uinputd_t* d, enum q11k_input idev)
+{
+    static const char* const names[Q11K_INPUT_COUNT] = {
+        [Q11K_INPUT_PEN]      = "Huion Q11K Tablet",
+        [Q11K_INPUT_KEYBOARD] = "Huion Q11K Keyboard",
+        [Q11K_INPUT_SCROLL]   = "Huion Q11K Scroll",
+    };
+    const q11k_area_matrix_t* m = &d->st.default_config.area_matrix;
+    struct uinput_setup setup;
+    int fd, i, rc = 0;
+
+    fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -errno;
+    }
+
+    switch (idev)
+    {
+        case Q11K_INPUT_PEN:
+            rc |= uinput_set(fd, UI_SET_EVBIT, EV_KEY);
+            rc |= uinput_set(fd, UI_SET_EVBIT, EV_ABS);
+            rc |= uinput_set(fd, UI_SET_EVBIT, EV_MSC);
+            rc |= uinput_set(fd, UI_SET_KEYBIT, BTN_TOOL_PEN);
+            rc |= uinput_set(fd, UI_SET_KEYBIT, BTN_TOUCH);
+            rc |= uinput_set(fd, UI_SET_KEYBIT, BTN_STYLUS);
+            rc |= uinput_set(fd, UI_SET_KEYBIT, BTN_STYLUS2);
+            rc |= uinput_set(fd, UI_SET_MSCBIT, MSC_TIMESTAMP);
+            rc |= uinput_set(fd, UI_SET_ABSBIT, ABS_X);
+            rc |= uinput_set(fd, UI_SET_ABSBIT, ABS_Y);
+            rc |= uinput_set(fd, UI_SET_ABSBIT, ABS_PRESSURE);
+            rc |= uinput_abs(fd, ABS_X, m->max_x);
+            rc |= uinput_abs(fd, ABS_Y, m->max_y);
+            rc |= uinput_abs(fd, ABS_PRESSURE, MAX_ABS_PRESSURE);
+            break;
+        case Q11K_INPUT_KEYBOARD:
+            rc |= uinput_set(fd, UI_SET_EVBIT, EV_KEY);
+            rc |= uinput_set(fd, UI_SET_EVBIT, EV_MSC);
+            rc |= uinput_set(fd, UI_SET_MSCBIT, MSC_SCAN);
+            for (i = 0; i < Q11K_KEYMAP_SIZE; i++)
+            {
+                if (d->st.pad.keymap[i] != KEY_RESERVED)
+                {
+                    rc |= uinput_set(fd, UI_SET_KEYBIT, d->st.pad.keymap[i]);
+                }
+            }
+            for (i = 0; i < Q11K_PAD_MODIFIER_COUNT; i++)
+            {
+                rc |= uinput_set(fd, UI_SET_KEYBIT, q11k_pad_modifiers[i]);
+            }
+            rc |= uinput_set(fd, UI_SET_KEYBIT, BTN_MIDDLE);
+            rc |= uinput_set(fd, UI_SET_KEYBIT, BTN_RIGHT);
+            break;
+        case Q11K_INPUT_SCROLL:
+            /* X/Y and BTN_LEFT only get the node tagged as a mouse */
+            rc |= uinput_set(fd, UI_SET_EVBIT, EV_KEY);
+            rc |= uinput_set(fd, UI_SET_EVBIT, EV_REL);
+            rc |= uinput_set(fd, UI_SET_RELBIT, REL_X);
+            rc |= uinput_set(fd, UI_SET_RELBIT, REL_Y);
+            rc |= uinput_set(fd, UI_SET_KEYBIT, BTN_LEFT);
+            rc |= uinput_set(fd, UI_SET_RELBIT, REL_WHEEL);
+            rc |= uinput_set(fd, UI_SET_RELBIT, REL_HWHEEL);
+            rc |= uinput_set(fd, UI_SET_RELBIT, REL_WHEEL_HI_RES);
+            rc |= uinput_set(fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES);
+            break;
+        default:
+            rc = -EINVAL;
+            break;
+    }
+
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_USB;
+    setup.id.vendor = (idev == Q11K_INPUT_PEN) ? 0x56a : 0x04b4;
+    snprintf(setup.name, sizeof(setup.name), "%s", names[idev]);
+
+    /* the capability calls only say whether one of them failed */
+    rc = (rc != 0) ? -EIO : 0;
+    if (rc == 0 && (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0))
+    {
+        rc = -errno;
+    }
+    if (rc != 0)
+    {
+        close(fd);
+        return rc;
+    }
+
+    d->out[idev].fd = fd;
+    d->out[idev].count = 0;
+    return 0;
+}
+
+static void uinput_destroy(uinputd_t* d)
+{
+    int i;
+
+    for (i = 0; i < Q11K_INPUT_COUNT; i++)
+    {
+        if (d->out[i].fd >= 0)
+        {
+            ioctl(d->out[i].fd, UI_DEV_DESTROY);
+            close(d->out[i].fd);
+            d->out[i].fd = -1;
+        }
+    }
+}
+
+/* Read every report queued on interface @iface; returns how many, or -errno */
+static int drain_hidraw(uinputd_t* d, int iface)
+{
+    int fd = d->hidraw[iface];
+    u8 buf[READ_BUF];
+    int n = 0;
+
+    for (;;)
+    {
+        ssize_t len = read(fd, buf, sizeof(buf));
+
+        if (len < 0)
+        {
+            return (errno == EAGAIN || errno == EINTR) ? n : -errno;
+        }
+        if (len == 0)
+        {
+            return -ENODEV;
+        }
+
+        q11k_core_iface_event(&d->st, iface, buf, (int)len, now_ns());
+        n++;
+    }
+}
+
+static void print_stats(const uinputd_t* d, u64 elapsed)
+{
+    struct rusage ru;
+    double cpu_ns;
+
+    getrusage(RUSAGE_SELF, &ru);
+    cpu_ns = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e9
+           + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e3;
+
+    fprintf(stderr, "q11k_uinputd: %lu reports, %lu frames in %.3f s, %lu wakeups (%.2f reports/wakeup)\n",
+            d->reports, d->frames, elapsed / 1e9, d->wakeups,
+            d->wakeups ? (double)d->reports / d->wakeups : 0.0);
+    fprintf(stderr, "q11k_uinputd: cpu %.3f ms user+sys, %.0f ns/report, %lu uinput write errors\n",
+            cpu_ns / 1e6, d->reports ? cpu_ns / d->reports : 0.0, d->write_errors);
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -P DEV      pen interface hidraw node (default: find input1 of 256c:006e)\n"
+        "  -K DEV      pad interface hidraw node (default: find input0 of 256c:006e)\n"
+        "  -w          wait for the tablet to appear\n"
+        "  -f          enable the pen filter (defaults as in the module)\n"
+        "  -D          disable the jitter deadband\n"
+        "  -s          enable the touch strip scroll mode\n"
+        "  -m          stylus buttons as middle/right mouse buttons\n",
+        prog);
+}
+
+int main(int argc, char** argv)
+{
+    static uinputd_t d;
+    const char* path[Q11K_UHID_IFACES] = { NULL, NULL };
+    struct epoll_event ev, events[Q11K_UHID_IFACES];
+    bool wait = false;
+    u64 start;
+    int i, opt, ep, rc = 0;
+
+    q11k_core_init(&d.st, &uinputd_sink_ops, &d);
+
+    while ((opt = getopt(argc, argv, "P:K:wfDsmh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'P': path[Q11K_UHID_IFACE_PEN] = optarg; break;
+            case 'K': path[Q11K_UHID_IFACE_PAD] = optarg; break;
+            case 'w': wait = true; break;
+            case 'f': d.st.default_config.filter.enabled = 1; break;
+            case 'D': d.st.default_config.deadband.enabled = 0; break;
+            case 's': d.st.default_config.scroll.enabled = 1; break;
+            case 'm': d.st.default_config.stylus_mode = Q11K_STYLUS_MOUSE; break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (access("/sys/module/q11k_device", F_OK) == 0)
+    {
+        fprintf(stderr, "q11k_uinputd: warning: the q11k_device module is loaded, events will be doubled\n");
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        d.hidraw[i] = -1;
+        while (path[i] == NULL && !stop_requested)
+        {
+            if (find_hidraw(i, d.hidraw_path[i], sizeof(d.hidraw_path[i])) == 0)
+            {
+                path[i] = d.hidraw_path[i];
+            }
+            else if (!wait)
+            {
+                fprintf(stderr, "q11k_uinputd: no hidraw node for interface %d\n", i);
+                return 1;
+            }
+            else
+            {
+                usleep(WAIT_POLL_MS * 1000);
+            }
+        }
+        if (stop_requested)
+        {
+            return 0;
+        }
+
+        d.hidraw[i] = open(path[i], O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (d.hidraw[i] < 0)
+        {
+            fprintf(stderr, "q11k_uinputd: %s: %s\n", path[i], strerror(errno));
+            return 1;
+        }
+    }
+
+    for (i = 0; i < Q11K_INPUT_COUNT; i++)
+    {
+        d.out[i].fd = -1;
+    }
+    for (i = 0; i < Q11K_INPUT_COUNT; i++)
+    {
+        rc = uinput_create(&d, i);
+        if (rc < 0)
+        {
+            fprintf(stderr, "q11k_uinputd: cannot create uinput device: %s\n", strerror(-rc));
+            uinput_destroy(&d);
+            return 1;
+        }
+    }
+
+    ep = epoll_create1(EPOLL_CLOEXEC);
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, d.hidraw[i], &ev);
+    }
+
+    fprintf(stderr, "q11k_uinputd: pad %s, pen %s\n", path[Q11K_UHID_IFACE_PAD], path[Q11K_UHID_IFACE_PEN]);
+    start = now_ns();
+
+    while (!stop_requested)
+    {
+        int n = epoll_wait(ep, events, Q11K_UHID_IFACES, prox_timeout_ms(&d));
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            rc = -errno;
+            break;
+        }
+
+        if (n == 0)
+        {
+            q11k_core_pen_release(&d.st, now_ns());
+            continue;
+        }
+
+        d.wakeups++;
+        for (i = 0; i < n; i++)
+        {
+            int got = drain_hidraw(&d, events[i].data.u32);
+
+            if (got < 0 || (events[i].events & (EPOLLHUP | EPOLLERR)))
+            {
+                fprintf(stderr, "q11k_uinputd: tablet gone\n");
+                stop_requested = 1;
+                break;
+            }
+            d.reports += got;
+        }
+    }
+
+    print_stats(&d, now_ns() - start);
+
+    close(ep);
+    uinput_destroy(&d);
+    for (i = 0; i < Q11K_UHID_IFACES; i++)
+    {
+        close(d.hidraw[i]);
+    }
+
+    return (rc < 0) ? 1 : 0;
+}